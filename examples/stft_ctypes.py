@@ -6,22 +6,42 @@ Simpler alternative that doesn't require compilation
 
 import ctypes
 import numpy as np
-from ctypes import Structure, POINTER, c_int, c_double, c_float, c_char_p, c_bool
+from ctypes import Structure, POINTER, c_int, c_uint, c_uint8, c_double, c_float, c_char_p, c_bool, c_void_p
 
 # Load the shared library (you'll need to compile it first)
-# gcc -shared -fPIC -o libstft.so stft.c kiss_fft.c -lm
+# gcc -O2 -shared -fPIC -Iinclude -Isrc -o libstft.so src/*.c -lm -pthread
 
+# Mirrors of the C structs, field for field in declaration order; C enums are ints
 class STFTParameters(Structure):
     _fields_ = [
         ("window_size", c_int),
         ("hop_size", c_int),
         ("sample_rate", c_double),
         ("window_type", c_int),
+        ("scaling", c_int),
+        ("energy_gate", c_bool),
+        ("gate_threshold_db", c_double),
+        ("accuracy", c_int),
+        ("layout", c_int),
+        ("format", c_int),
+        ("thread_count", c_int),
+        ("memory_hints", c_uint),
+        ("resample_up", c_int),
+        ("resample_down", c_int),
+        ("target_sample_rate", c_double),
     ]
 
 class ComplexFloat(Structure):
     _fields_ = [("r", c_float), ("i", c_float)]
 
+class STFTAllocator(Structure):
+    _fields_ = [
+        ("alloc", c_void_p),
+        ("free", c_void_p),
+        ("aligned_alloc", c_void_p),
+        ("ctx", c_void_p),
+    ]
+
 class STFTResult(Structure):
     _fields_ = [
         ("success", c_bool),
@@ -31,6 +51,17 @@ class STFTResult(Structure):
         ("frame_time", c_double),
         ("frequency_resolution", c_double),
         ("message", c_char_p),
+        ("gated_frames", POINTER(c_uint8)),
+        ("gated_frame_count", c_int),
+        ("accuracy", c_int),
+        ("layout", c_int),
+        ("bin_major_data", POINTER(ComplexFloat)),
+        ("format", c_int),
+        ("real_data", POINTER(c_float)),
+        ("imag_data", POINTER(c_float)),
+        ("plane_stride", c_int),
+        ("allocator", STFTAllocator),
+        ("frame_block", POINTER(ComplexFloat)),
     ]
 
 class STFTWrapper:
@@ -40,7 +71,7 @@ class STFTWrapper:
             self.lib = ctypes.CDLL(lib_path)
         except OSError:
             print(f"Failed to load {lib_path}")
-            print("Please compile first: gcc -shared -fPIC -o libstft.so stft.c kiss_fft.c -lm")
+            print("Please compile first: gcc -O2 -shared -fPIC -Iinclude -Isrc -o libstft.so src/*.c -lm -pthread")
             raise
         
         # Define function signatures
@@ -49,6 +80,10 @@ class STFTWrapper:
     def _setup_function_signatures(self):
         """Setup C function signatures"""
         
+        # stft_create_parameters fills every field with its default
+        self.lib.stft_create_parameters.argtypes = [c_int, c_int, c_double, c_int, c_int]
+        self.lib.stft_create_parameters.restype = STFTParameters
+        
         # perform_stft function
         self.lib.perform_stft.argtypes = [
             POINTER(c_float),  # input_data
@@ -68,7 +103,7 @@ class STFTWrapper:
         self.lib.stft_free_2d_array.argtypes = [POINTER(POINTER(c_float)), c_int]
         self.lib.stft_free_2d_array.restype = None
     
-    def perform_stft(self, signal, window_size, hop_size, sample_rate, window_type=0):
+    def perform_stft(self, signal, window_size, hop_size, sample_rate, window_type=0, scaling=0):
         """
         Perform STFT on input signal
         
@@ -78,6 +113,7 @@ class STFTWrapper:
             hop_size (int): Hop size in samples  
             sample_rate (float): Sample rate in Hz
             window_type (int): Window type (0=Hann)
+            scaling (int): Scaling type (0=spectrum, 1=PSD)
             
         Returns:
             dict: Dictionary containing spectrogram and metadata
@@ -94,12 +130,7 @@ class STFTWrapper:
             signal = np.ascontiguousarray(signal)
         
         # Create parameters
-        params = STFTParameters(
-            window_size=window_size,
-            hop_size=hop_size,
-            sample_rate=sample_rate,
-            window_type=window_type
-        )
+        params = self.lib.stft_create_parameters(window_size, hop_size, sample_rate, window_type, scaling)
         
         # Call C function
         input_data = signal.ctypes.data_as(POINTER(c_float))
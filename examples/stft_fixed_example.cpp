@@ -0,0 +1,56 @@
+// Compile-time 512/128 STFT checked against the runtime plan. Build with `make cpp-example`.
+#include "../include/stft.hpp"
+#include "../include/stft_fixed.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// The largest supported window must still build its tables within the constexpr limits
+static_assert(stft::Fixed<65536, 16384>::spectrum_scale > 0.0f, "Fixed tables build at the maximum window");
+
+int main() {
+    const double sample_rate = 16000.0;
+    std::vector<float> signal(16000 * 10);
+    for (size_t i = 0; i < signal.size(); i++) {
+        double t = i / sample_rate;
+        signal[i] = (float)(std::sin(2.0 * M_PI * (200.0 + 300.0 * t) * t) + 0.25 * std::sin(2.0 * M_PI * 3000.0 * t));
+    }
+
+    using Fixed = stft::Fixed<512, 128, stft::Window::Hann>;
+    Fixed fixed(sample_rate);
+    stft::Plan plan(fixed.parameters());
+
+    std::vector<kiss_fft_cpx> output((size_t)Fixed::frame_count(signal.size()) * Fixed::bin_count);
+    auto start = std::chrono::steady_clock::now();
+    int frames = fixed.process(signal, output);
+    auto middle = std::chrono::steady_clock::now();
+    stft::Result result = plan.execute(signal);
+    auto end = std::chrono::steady_clock::now();
+
+    if (!result || frames != result.frame_count()) {
+        std::printf("Frame count mismatch: %d vs %d\n", frames, result.frame_count());
+        return 1;
+    }
+
+    // Largest difference relative to the frame's peak bin
+    double worst = 0.0;
+    std::vector<kiss_fft_cpx> scratch(Fixed::bin_count);
+    for (int frame = 0; frame < frames; frame++) {
+        auto expected = result.frame(frame, scratch);
+        double peak = 0.0, error = 0.0;
+        for (int bin = 0; bin < Fixed::bin_count; bin++) {
+            const kiss_fft_cpx &got = output[(size_t)frame * Fixed::bin_count + bin];
+            peak = std::fmax(peak, std::hypot(expected[bin].r, expected[bin].i));
+            error = std::fmax(error, std::hypot(got.r - expected[bin].r, got.i - expected[bin].i));
+        }
+        if (peak > 0.0) worst = std::fmax(worst, error / peak);
+    }
+
+    double fixed_ms = std::chrono::duration<double, std::milli>(middle - start).count();
+    double plan_ms = std::chrono::duration<double, std::milli>(end - middle).count();
+    std::printf("Fixed<512,128>: %.2f ms, plan: %.2f ms, %d frames, max relative error %.2e\n",
+                fixed_ms, plan_ms, frames, worst);
+    return worst < 1e-5 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+// Two coroutine stages chained on a streaming STFT: magnitudes, then peak tracking.
+// Build with `make cpp-example`.
+#include "../include/stft.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Stage 1: magnitude of every frame, handed on as a view of this stage's own buffer
+static stft::Task magnitudes(stft::FrameSource &source, stft::Channel<std::span<const float>> &out, int bin_count) {
+    std::vector<float> row(bin_count);
+    while (auto frame = co_await source.next()) {
+        stft_magnitude_row(frame->bins.data(), bin_count, ACCURACY_FAST, row.data());
+        out.send(row);
+    }
+    out.close();
+}
+
+// Stage 2: strongest bin per frame
+static stft::Task peaks(stft::Channel<std::span<const float>> &in, std::vector<int> &peak_bins) {
+    while (auto row = co_await in.next()) {
+        int best = 0;
+        for (int bin = 1; bin < (int)row->size(); bin++) {
+            if ((*row)[bin] > (*row)[best]) best = bin;
+        }
+        peak_bins.push_back(best);
+    }
+}
+
+int main() {
+    const double sample_rate = 16000.0;
+    std::vector<float> signal(16000);
+    for (size_t i = 0; i < signal.size(); i++) {
+        signal[i] = (float)std::sin(2.0 * M_PI * 1000.0 * i / sample_rate);
+    }
+
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+
+    // Batch analysis through an RAII plan
+    stft::Plan plan(params);
+    stft::Result result = plan.execute(signal);
+    if (!result) {
+        std::printf("STFT failed: %s\n", result.message());
+        return 1;
+    }
+
+    // The same signal streamed through the coroutine pipeline in 300-sample blocks
+    int bin_count = params.window_size / 2 + 1;
+    stft::FrameSource source(params);
+    stft::Channel<std::span<const float>> rows;
+    std::vector<int> peak_bins;
+    stft::Task sink = peaks(rows, peak_bins);
+    stft::Task stage = magnitudes(source, rows, bin_count);
+
+    for (size_t offset = 0; offset < signal.size(); offset += 300) {
+        size_t count = signal.size() - offset < 300 ? signal.size() - offset : 300;
+        source.push(std::span<const float>(signal).subspan(offset, count));
+    }
+    source.close();
+    stage.rethrow_if_failed();
+    sink.rethrow_if_failed();
+
+    std::printf("Plan frames: %d, streamed frames: %zu, peak at %.1f Hz\n", result.frame_count(), peak_bins.size(),
+                peak_bins.empty() ? 0.0 : peak_bins[0] * sample_rate / params.window_size);
+    return (int)peak_bins.size() == result.frame_count() && stage.done() && sink.done() ? 0 : 1;
+}
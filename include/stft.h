@@ -2,6 +2,8 @@
 #define STFT_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "../src/kiss_fft.h"
 
 #ifdef __cplusplus
@@ -17,12 +19,52 @@ typedef enum {
     SCALING_PSD
 } ScalingType;
 
+typedef enum {
+    ACCURACY_EXACT,     // libm, identical to the cpx_* helpers
+    ACCURACY_FAST       // SIMD polynomials: < 5e-5 dB, < 2e-6 rad, < 3e-7 relative magnitude
+} STFTAccuracy;
+
+typedef enum {
+    LAYOUT_FRAME_MAJOR, // spectrogram_data[frame][bin]
+    LAYOUT_BIN_MAJOR    // bin_major_data[bin * frame_count + frame], spectrogram_data is NULL
+} SpectrogramLayout;
+
+typedef enum {
+    COMPLEX_INTERLEAVED,    // kiss_fft_cpx {r, i} pairs
+    COMPLEX_SPLIT           // separate 64-byte aligned real and imaginary planes
+} ComplexFormat;
+
+// Runtime allocator for plans and their results. aligned_alloc may be NULL, in which case
+// aligned blocks are carved out of alloc; free receives pointers from both.
+typedef struct {
+    void* (*alloc)(void *ctx, size_t size);
+    void (*free)(void *ctx, void *ptr);
+    void* (*aligned_alloc)(void *ctx, size_t size, size_t alignment);
+    void *ctx;
+} STFTAllocator;
+
+typedef enum {
+    MEMORY_DEFAULT = 0,
+    MEMORY_HUGE_PAGES = 1 << 0,     // back plan and result buffers with huge pages (explicit, else THP)
+    MEMORY_NUMA_LOCAL = 1 << 1      // pin workers; output pages are first touched by the worker filling them
+} MemoryHint;
+
 typedef struct {
     int window_size;
     int hop_size;
     double sample_rate;
     WindowType window_type;
     ScalingType scaling;
+    bool energy_gate;               // skip the FFT of frames quieter than gate_threshold_db
+    double gate_threshold_db;       // window-weighted mean power of the frame, in dB
+    STFTAccuracy accuracy;          // kernels used by the magnitude/phase/dB getters
+    SpectrogramLayout layout;       // storage order of perform_stft output
+    ComplexFormat format;           // interleaved or split real/imaginary planes
+    int thread_count;               // plan execution threads including the caller; <= 1 is single-threaded
+    unsigned memory_hints;          // MemoryHint flags
+    int resample_up;                // polyphase pre-stage: frames are cut from the input resampled
+    int resample_down;              // to sample_rate * up / down; 0 or 1 for both leaves it off
+    double target_sample_rate;      // > 0: resample to this rate instead, any ratio; excludes up/down
 } STFTParameters;
 
 typedef struct {
@@ -33,27 +75,101 @@ typedef struct {
     double frame_time;
     double frequency_resolution;
     char *message;
+    uint8_t *gated_frames;          // bitmap of frames skipped by the energy gate, NULL if gating is off
+    int gated_frame_count;
+    STFTAccuracy accuracy;          // copied from the parameters
+    SpectrogramLayout layout;
+    kiss_fft_cpx *bin_major_data;   // [bin * frame_count + frame], LAYOUT_BIN_MAJOR only
+    ComplexFormat format;
+    float *real_data;               // COMPLEX_SPLIT only: [row * plane_stride + column], where a row
+    float *imag_data;               // is a frame (frame-major) or a bin (bin-major); other arrays are NULL
+    int plane_stride;               // floats per row, a multiple of 16 so every row is 64-byte aligned
+    STFTAllocator allocator;        // owns this result and the arrays its getters return
+    kiss_fft_cpx *frame_block;      // single block behind the spectrogram_data rows, NULL if rows are separate
 } STFTResult;
 
+typedef struct {
+    int index;                  // frame number
+    int start_sample;           // offset of the frame in the input
+    const kiss_fft_cpx *bins;   // scaled spectrum, valid only during the callback
+    int bin_count;
+    bool gated;                 // below the energy gate; bins are all zero
+    const float *real;          // COMPLEX_SPLIT only: the same bins as 64-byte aligned planes, else NULL
+    const float *imag;
+} STFTFrame;
+
+typedef void (*STFTFrameCallback)(const STFTFrame *frame, void *user_data);
+
 
 STFTParameters stft_create_parameters(int window_size, int hop_size, double sample_rate, WindowType window_type, ScalingType scaling);
 char* stft_validate_parameters(const STFTParameters *params);
 double stft_get_overlap_percentage(const STFTParameters *params);
+// Rate the frames are cut at: sample_rate after the resampling pre-stage. frame_time,
+// frequency_resolution, PSD scaling and frame start offsets are all in this rate.
+double stft_analysis_rate(const STFTParameters *params);
 double stft_get_frame_time(const STFTParameters *params);
 double stft_get_frequency_resolution(const STFTParameters *params);
 
 float* generate_hann_window(int window_size);
 float* generate_window(WindowType window_type, int window_size);
 
+// Reusable analysis state: window, FFT tables and scratch are built once and every
+// allocation goes through allocator (NULL for malloc). With thread_count > 1 the plan owns a
+// worker pool and splits frames across it; the allocator is still only called from the
+// creating and executing threads. A plan is not safe to execute concurrently.
+typedef struct STFTPlan STFTPlan;
+
+const STFTAllocator* stft_default_allocator(void);
+// Blocks of 1 MB and up are mmap'ed on 2 MB boundaries: MAP_HUGETLB if pages are reserved,
+// otherwise madvise(MADV_HUGEPAGE). Smaller blocks come from malloc. Used by plans created
+// with MEMORY_HUGE_PAGES and no allocator of their own.
+const STFTAllocator* stft_huge_page_allocator(void);
+STFTPlan* stft_plan_create(const STFTParameters *params, const STFTAllocator *allocator);
+STFTResult* stft_plan_execute(STFTPlan *plan, const float *input_data, int input_length);
+const STFTParameters* stft_plan_parameters(const STFTPlan *plan);
+void stft_plan_destroy(STFTPlan *plan);
+
+// One-shot plan create + execute + destroy
 STFTResult* perform_stft(const float *input_data, int input_length, const STFTParameters *params);
 
+// Inverse STFT by weighted overlap-add; returns (frame_count - 1) * hop_size + window_size samples
+// at the analysis rate
+float* perform_istft(const STFTResult *result, const STFTParameters *params, int *output_length);
+
+// Samples the frame loop sees for input_length input samples: ceil(input_length * up / down)
+// or ceil(input_length * target_sample_rate / sample_rate). Resampled lengths past INT_MAX are
+// returned as they are, but every analysis entry point rejects them.
+int64_t stft_get_analysis_length(const STFTParameters *params, int input_length);
+// Frames over the analysis-rate length of input_length input samples; 0 if that length passes INT_MAX
+int stft_get_frame_count(const STFTParameters *params, int input_length);
+
+// Runs the STFT frame loop and hands each scaled frame to callback instead of storing it.
+// Returns NULL on success or an error message the caller must free.
+char* stft_process_frames(const float *input_data, int input_length, const STFTParameters *params,
+                          STFTFrameCallback callback, void *user_data);
+
+// One frame of either layout; bin-major frames are gathered into scratch (frequency_bin_count entries)
+const kiss_fft_cpx* stft_get_frame(const STFTResult *result, int frame, kiss_fft_cpx *scratch);
+// Contiguous time series of one bin (frame_count entries), NULL unless the result is bin-major and interleaved
+const kiss_fft_cpx* stft_get_bin_series(const STFTResult *result, int bin);
+
+// Getters always return [frame][bin] rows, whatever the result layout
 float** stft_get_magnitude_spectrogram(const STFTResult *result);
 float** stft_get_phase_spectrogram(const STFTResult *result);
 float** stft_get_power_spectrogram_db(const STFTResult *result);
 
+// Whole-row post-processing kernels used by the getters above
+void stft_magnitude_row(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output);
+void stft_power_db_row(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output);
+void stft_phase_row(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output);
+
 
 void stft_free_result(STFTResult *result);
 void stft_free_2d_array(float **array, int rows);
+// Frees a getter output through the result's allocator; required for non-malloc allocators
+void stft_result_free_2d_array(const STFTResult *result, float **array);
+
+bool stft_frame_is_gated(const STFTResult *result, int frame);
 
 double cpx_magnitude(kiss_fft_cpx c);
 double cpx_phase(kiss_fft_cpx c);
@@ -0,0 +1,229 @@
+#ifndef STFT_HPP
+#define STFT_HPP
+
+// Header-only C++20 layer over stft.h: RAII plans and results, std::span views, and a
+// co_await-able frame source for chaining streaming stages as coroutines.
+
+#include "stft.h"
+#include "stft_stream.h"
+
+#include <coroutine>
+#include <cstdlib>
+#include <exception>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace stft {
+
+// Owns an STFTResult; move-only
+class Result {
+public:
+    Result() = default;
+    explicit Result(STFTResult *result) noexcept : result_(result) {}
+    Result(Result &&other) noexcept : result_(std::exchange(other.result_, nullptr)) {}
+    Result& operator=(Result &&other) noexcept {
+        if (this != &other) {
+            stft_free_result(result_);
+            result_ = std::exchange(other.result_, nullptr);
+        }
+        return *this;
+    }
+    Result(const Result&) = delete;
+    Result& operator=(const Result&) = delete;
+    ~Result() { stft_free_result(result_); }
+
+    explicit operator bool() const noexcept { return result_ && result_->success; }
+    const char* message() const noexcept { return result_ && result_->message ? result_->message : ""; }
+    int frame_count() const noexcept { return result_ ? result_->frame_count : 0; }
+    int bin_count() const noexcept { return result_ ? result_->frequency_bin_count : 0; }
+
+    // One frame of bins in any layout or format. Frame-major interleaved results return a view
+    // of their own storage; others are gathered into scratch (bin_count entries).
+    std::span<const kiss_fft_cpx> frame(int index, std::span<kiss_fft_cpx> scratch) const {
+        const kiss_fft_cpx *bins = stft_get_frame(result_, index, scratch.data());
+        return bins ? std::span<const kiss_fft_cpx>(bins, bin_count()) : std::span<const kiss_fft_cpx>();
+    }
+
+    const STFTResult* get() const noexcept { return result_; }
+    STFTResult* release() noexcept { return std::exchange(result_, nullptr); }
+
+private:
+    STFTResult *result_ = nullptr;
+};
+
+// Owns an STFTPlan; move-only, so the window and twiddle tables are built exactly once
+class Plan {
+public:
+    explicit Plan(const STFTParameters &params, const STFTAllocator *allocator = nullptr)
+        : plan_(stft_plan_create(&params, allocator)) {
+        if (!plan_) {
+            char *error = stft_validate_parameters(&params);
+            std::string message = error ? error : "Failed to create STFT plan";
+            std::free(error);
+            throw std::invalid_argument(message);
+        }
+    }
+    Plan(Plan &&other) noexcept : plan_(std::exchange(other.plan_, nullptr)) {}
+    Plan& operator=(Plan &&other) noexcept {
+        if (this != &other) {
+            stft_plan_destroy(plan_);
+            plan_ = std::exchange(other.plan_, nullptr);
+        }
+        return *this;
+    }
+    Plan(const Plan&) = delete;
+    Plan& operator=(const Plan&) = delete;
+    ~Plan() { stft_plan_destroy(plan_); }
+
+    Result execute(std::span<const float> input) {
+        return Result(stft_plan_execute(plan_, input.data(), static_cast<int>(input.size())));
+    }
+
+    const STFTParameters& parameters() const noexcept { return *stft_plan_parameters(plan_); }
+    STFTPlan* get() const noexcept { return plan_; }
+
+private:
+    STFTPlan *plan_ = nullptr;
+};
+
+// Coroutine return type for pipeline stages. Starts eagerly and runs until its first co_await;
+// the frame is freed with the Task. Exceptions are kept and rethrown by rethrow_if_failed.
+class Task {
+public:
+    struct promise_type {
+        std::exception_ptr exception;
+
+        Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool done() const noexcept { return !handle_ || handle_.done(); }
+    void rethrow_if_failed() const {
+        if (handle_ && handle_.promise().exception) std::rethrow_exception(handle_.promise().exception);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Single-slot rendezvous between a producer and one awaiting coroutine. send() resumes the
+// consumer inline with the value and returns once it suspends again, so nothing is queued
+// and nothing is allocated per value.
+template <class T>
+class Channel {
+public:
+    struct Awaiter {
+        Channel &channel;
+
+        bool await_ready() const noexcept { return channel.closed_; }
+        void await_suspend(std::coroutine_handle<> consumer) noexcept { channel.consumer_ = consumer; }
+        std::optional<T> await_resume() noexcept { return std::exchange(channel.value_, std::nullopt); }
+    };
+
+    Channel() = default;
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    // Awaits the next value; std::nullopt once the channel is closed
+    Awaiter next() noexcept { return Awaiter{ *this }; }
+
+    // False (value dropped) if no consumer is waiting
+    bool send(T value) {
+        if (!consumer_) return false;
+        value_.emplace(std::move(value));
+        std::exchange(consumer_, nullptr).resume();
+        return true;
+    }
+
+    void close() {
+        closed_ = true;
+        if (consumer_) std::exchange(consumer_, nullptr).resume();
+    }
+
+    bool waiting() const noexcept { return static_cast<bool>(consumer_); }
+
+private:
+    std::coroutine_handle<> consumer_;
+    std::optional<T> value_;
+    bool closed_ = false;
+};
+
+// A frame as seen by a pipeline stage; the views are valid until the stage next suspends
+struct Frame {
+    int index;
+    int start_sample;
+    bool gated;
+    std::span<const kiss_fft_cpx> bins;
+    std::span<const float> real;    // COMPLEX_SPLIT only, else empty
+    std::span<const float> imag;
+};
+
+// Streaming analysis whose frames are awaited by a coroutine:
+//
+//     stft::Task stage(stft::FrameSource &source) {
+//         while (auto frame = co_await source.next()) { ... }
+//     }
+//
+// push() runs the stage inline for every frame the samples complete, handing it the
+// stream's own output buffer.
+class FrameSource {
+public:
+    explicit FrameSource(const STFTParameters &params) : stream_(stft_stream_create(&params)) {
+        if (!stream_) throw std::invalid_argument("Failed to create STFT stream");
+    }
+    // Not movable: the stream callback holds this pointer
+    FrameSource(FrameSource&&) = delete;
+    FrameSource(const FrameSource&) = delete;
+    FrameSource& operator=(const FrameSource&) = delete;
+    ~FrameSource() { stft_stream_free(stream_); }
+
+    Channel<Frame>::Awaiter next() noexcept { return frames_.next(); }
+
+    // Returns the number of frames completed; frames arriving while no stage waits are dropped
+    int push(std::span<const float> samples) {
+        return stft_stream_push(stream_, samples.data(), static_cast<int>(samples.size()), &FrameSource::deliver, this);
+    }
+
+    // Ends the stream: the waiting stage's next() yields std::nullopt
+    void close() { frames_.close(); }
+
+private:
+    static void deliver(const STFTFrame *frame, void *user_data) {
+        FrameSource *source = static_cast<FrameSource*>(user_data);
+        Frame view{ frame->index, frame->start_sample, frame->gated,
+                    std::span<const kiss_fft_cpx>(frame->bins, frame->bin_count), {}, {} };
+        if (frame->real) {
+            view.real = std::span<const float>(frame->real, frame->bin_count);
+            view.imag = std::span<const float>(frame->imag, frame->bin_count);
+        }
+        source->frames_.send(view);
+    }
+
+    STFTStream *stream_;
+    Channel<Frame> frames_;
+};
+
+} // namespace stft
+
+#endif // STFT_HPP
@@ -0,0 +1,32 @@
+#ifndef STFT_ARENA_H
+#define STFT_ARENA_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump allocator for per-job memory: frees are no-ops and everything is released at once by
+// stft_arena_reset. Results allocated from an arena are invalid after the reset.
+typedef struct STFTArena STFTArena;
+
+// block_size is the initial capacity; the arena grows by chaining blocks and folds them into
+// one block of the high-water size on the next reset. backing may be NULL for malloc.
+STFTArena* stft_arena_create(size_t block_size, const STFTAllocator *backing);
+void stft_arena_destroy(STFTArena *arena);
+
+// Allocator view of the arena, valid for the arena's lifetime
+STFTAllocator stft_arena_allocator(STFTArena *arena);
+void stft_arena_reset(STFTArena *arena);
+
+size_t stft_arena_bytes_used(const STFTArena *arena);
+size_t stft_arena_high_water(const STFTArena *arena);
+size_t stft_arena_capacity(const STFTArena *arena);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_ARENA_H
@@ -0,0 +1,41 @@
+#ifndef STFT_ASYNC_H
+#define STFT_ASYNC_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Handle for one queued stft_plan_execute. Jobs run on a shared background executor; jobs on
+// the same plan run one at a time in submission order, jobs on different plans in parallel.
+typedef struct STFTJob STFTJob;
+
+// Runs on an executor thread once the result is ready, before the job counts as finished.
+typedef void (*STFTCompletionCallback)(STFTJob *job, STFTResult *result, void *user_data);
+
+
+// input_data must stay valid until the job finishes. The result is stored in *out (if out is
+// not NULL) before the callback runs; however it is delivered, the caller frees it once with
+// stft_free_result. Returns NULL if the job could not be queued.
+STFTJob* stft_submit(STFTPlan *plan, const float *input_data, int input_length, STFTResult **out,
+                     STFTCompletionCallback callback, void *user_data);
+// Non-blocking: true once the result is stored and the callback has returned
+bool stft_job_poll(const STFTJob *job);
+// Blocks until the job finishes and returns its result
+STFTResult* stft_job_wait(STFTJob *job);
+// An eventfd that becomes readable when the job finishes, for epoll/io_uring loops. Owned by
+// the job; -1 where eventfd is unavailable.
+int stft_job_eventfd(STFTJob *job);
+// Drops the caller's handle. A job released before it finishes still runs to completion.
+void stft_job_release(STFTJob *job);
+
+// Finishes every queued job and stops the executor threads; the next submit restarts them
+void stft_async_shutdown(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_ASYNC_H
@@ -0,0 +1,43 @@
+#ifndef STFT_BATCH_H
+#define STFT_BATCH_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const float *input_data;
+    int input_length;
+    const STFTParameters *params;   // thread_count and memory_hints are ignored in a batch
+} STFTBatchJob;
+
+typedef struct {
+    int thread_count;       // including the caller; <= 0 uses every CPU the process may run on
+    int target_frames;      // frames per scheduled task: longer inputs are split, shorter ones packed
+} BatchOptions;
+
+typedef struct {
+    bool success;           // false only if the batch could not be scheduled at all
+    STFTResult **results;   // [job_count] in job order; each carries its own success and message
+    int job_count;
+    int failed_count;
+    char *message;
+} BatchResult;
+
+
+BatchOptions batch_default_options(void);
+
+// Runs every job over one work-stealing pool. Each input is cut into frame ranges of about
+// target_frames, and clips shorter than that are packed into shared tasks, so a few long files
+// or many tiny ones keep all workers busy to the end. Output matches perform_stft per job.
+BatchResult* perform_stft_batch(const STFTBatchJob *jobs, int job_count, const BatchOptions *options);
+void batch_free_result(BatchResult *result);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_BATCH_H
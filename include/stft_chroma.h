@@ -0,0 +1,46 @@
+#ifndef STFT_CHROMA_H
+#define STFT_CHROMA_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHROMA_BIN_COUNT 12
+
+// Sparse bin -> pitch class weights for one (sample_rate, window_size) pair.
+// Entries are sorted by bin; each bin contributes to at most two pitch classes.
+typedef struct {
+    double sample_rate;
+    int window_size;
+    int entry_count;
+    int *bin_index;
+    int *pitch_class;   // 0 = C, 9 = A
+    float *weight;
+} ChromaMap;
+
+typedef struct {
+    bool success;
+    float *chroma;      // [frame * CHROMA_BIN_COUNT + pitch_class]
+    int frame_count;
+    double frame_time;
+    char *message;
+} ChromaResult;
+
+
+ChromaMap* chroma_map_create(double sample_rate, int window_size, double tuning_hz, double min_hz, double max_hz);
+void chroma_map_free(ChromaMap *map);
+void chroma_map_apply(const ChromaMap *map, const kiss_fft_cpx *bins, float *chroma);
+
+// Computes normalized chroma in the same pass as the STFT; the spectrogram is never stored.
+// map may be NULL, in which case a default map (A4 = 440 Hz, 55 Hz - 5 kHz) is built for params.
+ChromaResult* perform_stft_chroma(const float *input_data, int input_length, const STFTParameters *params, const ChromaMap *map);
+void chroma_free_result(ChromaResult *result);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_CHROMA_H
@@ -0,0 +1,50 @@
+#ifndef STFT_DENOISE_H
+#define STFT_DENOISE_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    DENOISE_WIENER,                 // decision-directed a priori SNR, G = xi / (1 + xi)
+    DENOISE_SPECTRAL_SUBTRACTION    // G = sqrt(1 - over_subtraction * noise / power)
+} DenoiseGainRule;
+
+typedef enum {
+    NOISE_MINIMUM_STATISTICS,       // bias-compensated minimum of the smoothed power
+    NOISE_RECURSIVE_AVERAGING       // average of the power in frames judged noise-only
+} NoiseEstimator;
+
+typedef struct {
+    DenoiseGainRule gain_rule;
+    NoiseEstimator noise_estimator;
+    float power_smoothing;          // smoothing of the per-bin power before the minimum search
+    float noise_window_seconds;     // minimum statistics search span
+    float noise_smoothing;          // recursive averaging update factor
+    float over_subtraction;
+    float decision_directed;        // weight of the previous frame in the a priori SNR
+    float gain_floor_db;
+} DenoiseOptions;
+
+typedef struct Denoiser Denoiser;
+
+
+DenoiseOptions denoise_default_options(void);
+
+// Real-time denoiser on the streaming STFT. All state is allocated here; processing
+// never allocates. Output is delayed by denoiser_latency() samples.
+Denoiser* denoiser_create(const STFTParameters *params, const DenoiseOptions *options);
+// Writes exactly count output samples for count input samples.
+void denoiser_process(Denoiser *denoiser, const float *input, int count, float *output);
+int denoiser_latency(const Denoiser *denoiser);
+void denoiser_reset(Denoiser *denoiser);
+void denoiser_free(Denoiser *denoiser);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_DENOISE_H
@@ -0,0 +1,64 @@
+#ifndef STFT_ENCODE_H
+#define STFT_ENCODE_H
+
+#include "stft.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ENCODE_U8_DB,       // (db - min_db) mapped linearly onto 0..255
+    ENCODE_U16_DB,      // (db - min_db) mapped linearly onto 0..65535
+    ENCODE_F16_DB,      // IEEE half precision dB
+    ENCODE_BF16_DB      // bfloat16 dB
+} SpectrogramEncoding;
+
+typedef struct {
+    SpectrogramEncoding encoding;
+    float min_db;       // integer encodings clamp to [min_db, max_db];
+    float max_db;       // float encodings keep the full dB value
+} EncodeOptions;
+
+typedef struct {
+    bool success;
+    void *data;         // [frame * frequency_bin_count + bin], encode_element_size() bytes each
+    SpectrogramEncoding encoding;
+    float min_db;
+    float max_db;
+    int frame_count;
+    int frequency_bin_count;
+    double frame_time;
+    double frequency_resolution;
+    char *message;
+} EncodedResult;
+
+
+EncodeOptions encode_default_options(void);
+size_t encode_element_size(SpectrogramEncoding encoding);
+
+// Power dB of one frame, written straight into the compact format. scratch holds bin_count floats.
+void encode_power_db_row(const kiss_fft_cpx *bins, int bin_count, const EncodeOptions *options,
+                         STFTAccuracy accuracy, float *scratch, void *output);
+// Expands count encoded values back to dB.
+void decode_power_db_row(const void *input, int count, const EncodeOptions *options, float *output);
+
+// Runs the STFT and stores only the encoded power spectrogram; no float spectrogram is kept.
+EncodedResult* perform_stft_encoded(const float *input_data, int input_length, const STFTParameters *params,
+                                    const EncodeOptions *options);
+// Encodes an existing STFT result.
+EncodedResult* stft_encode_result(const STFTResult *result, const EncodeOptions *options);
+void encoded_free_result(EncodedResult *result);
+
+uint16_t stft_float_to_half(float value);
+float stft_half_to_float(uint16_t value);
+uint16_t stft_float_to_bf16(float value);
+float stft_bf16_to_float(uint16_t value);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_ENCODE_H
@@ -0,0 +1,209 @@
+#ifndef STFT_FIXED_HPP
+#define STFT_FIXED_HPP
+
+// Compile-time sized STFT for fixed window and hop sizes: window, twiddle and bit-reversal
+// tables are constexpr, the FFT loops have constant trip counts, and scratch lives on the
+// stack. Output matches perform_stft to float rounding.
+
+#include "stft.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace stft {
+
+enum class Window { Hann };
+
+namespace detail {
+
+constexpr double pi = 3.14159265358979323846;
+
+// Taylor series after reduction to [-pi, pi]; accurate to double rounding, usable in constexpr
+constexpr double fixed_cos(double x) {
+    double turns = x / (2.0 * pi);
+    long long whole = static_cast<long long>(turns < 0 ? turns - 0.5 : turns + 0.5);
+    x -= 2.0 * pi * static_cast<double>(whole);
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; k < 24 && (term < 0 ? -term : term) > 1e-18; k++) {
+        term *= -x * x / ((2.0 * k - 1.0) * (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr bool is_power_of_two(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Tables for an N-point real FFT computed as an N/2-point complex FFT plus a split step
+template <int N, Window W>
+struct FixedTables {
+    static constexpr int half = N / 2;
+    static constexpr int quarter = N / 4;
+
+    // Built-in arrays: std::array's operator[] costs a call per access in constant evaluation
+    float window[N]{};
+    kiss_fft_cpx twiddles[half / 2]{};      // e^(-2 pi i k / half)
+    kiss_fft_cpx split_twiddles[half]{};    // e^(-2 pi i k / N)
+    std::uint32_t bit_reverse[half]{};
+    double window_sum = 0.0;
+    double window_sum_sq = 0.0;
+
+    constexpr FixedTables() {
+        // Every table reads cos(2 pi k / N) from one quarter wave by symmetry, so only N / 4 + 1
+        // Taylor series are evaluated; that keeps N = 65536 inside the constexpr operation limit
+        double quarter_wave[quarter + 1]{};
+        for (int k = 0; k <= quarter; k++) {
+            quarter_wave[k] = fixed_cos(2.0 * pi * k / N);
+        }
+        for (int n = 0; n < N; n++) {
+            // Same periodic Hann as stft_fill_window
+            window[n] = static_cast<float>(0.5 * (1.0 - cos_at(quarter_wave, n)));
+            window_sum += window[n];
+            window_sum_sq += static_cast<double>(window[n]) * window[n];
+        }
+        for (int k = 0; k < half / 2; k++) {
+            twiddles[k] = kiss_fft_cpx{ static_cast<float>(cos_at(quarter_wave, 2 * k)),
+                                        static_cast<float>(-sin_at(quarter_wave, 2 * k)) };
+        }
+        for (int k = 0; k < half; k++) {
+            split_twiddles[k] = kiss_fft_cpx{ static_cast<float>(cos_at(quarter_wave, k)),
+                                              static_cast<float>(-sin_at(quarter_wave, k)) };
+        }
+        // reverse(k) is reverse(k / 2) shifted down, with k's low bit moved to the top
+        for (int k = 1; k < half; k++) {
+            bit_reverse[k] = (bit_reverse[k >> 1] >> 1) | (static_cast<std::uint32_t>(k & 1) * (half >> 1));
+        }
+    }
+
+    // cos(2 pi k / N) for k in [0, N)
+    static constexpr double cos_at(const double *quarter_wave, int k) {
+        if (k <= quarter) return quarter_wave[k];
+        if (k <= half) return -quarter_wave[half - k];
+        if (k <= half + quarter) return -quarter_wave[k - half];
+        return quarter_wave[N - k];
+    }
+
+    // sin(2 pi k / N) = cos(2 pi (k - N / 4) / N)
+    static constexpr double sin_at(const double *quarter_wave, int k) {
+        return cos_at(quarter_wave, (k + N - quarter) % N);
+    }
+};
+
+} // namespace detail
+
+template <int N, int Hop, Window W = Window::Hann>
+class Fixed {
+    static_assert(detail::is_power_of_two(N) && N >= 8, "Fixed needs a power-of-two window of at least 8");
+    static_assert(N <= (1 << 16), "Fixed keeps its scratch on the stack; use a plan above 65536");
+    static_assert(Hop > 0 && Hop <= N, "Hop must be in [1, N]");
+
+    static constexpr detail::FixedTables<N, W> tables{};
+    static constexpr int half = N / 2;
+
+public:
+    static constexpr int window_size = N;
+    static constexpr int hop_size = Hop;
+    static constexpr int bin_count = N / 2 + 1;
+    static constexpr float spectrum_scale = static_cast<float>(1.0 / (tables.window_sum * tables.window_sum));
+
+    explicit Fixed(double sample_rate, ScalingType scaling = SCALING_SPECTRUM) noexcept
+        : sample_rate_(sample_rate), scaling_(scaling),
+          scale_(scaling == SCALING_SPECTRUM ? spectrum_scale
+                                             : static_cast<float>(1.0 / (sample_rate * tables.window_sum_sq))) {}
+
+    static constexpr std::span<const float, N> window() noexcept { return tables.window; }
+
+    static constexpr int frame_count(std::size_t input_length) noexcept {
+        return input_length < static_cast<std::size_t>(N) ? 0 : static_cast<int>((input_length - N) / Hop + 1);
+    }
+
+    // Equivalent STFTParameters, for handing results to the C API
+    STFTParameters parameters() const noexcept {
+        return stft_create_parameters(N, Hop, sample_rate_, WINDOW_HANN, scaling_);
+    }
+
+    // One frame: N samples in, bin_count scaled bins out
+    void transform(std::span<const float, N> samples, std::span<kiss_fft_cpx, bin_count> bins) const noexcept {
+        // Even samples in the real part, odd in the imaginary part, stored in bit-reversed order
+        std::array<kiss_fft_cpx, half> z;
+        for (int n = 0; n < half; n++) {
+            std::uint32_t slot = tables.bit_reverse[n];
+            z[slot].r = samples[2 * n] * tables.window[2 * n];
+            z[slot].i = samples[2 * n + 1] * tables.window[2 * n + 1];
+        }
+
+        radix4_first_stage(z);
+        for (int span = 4; span < half; span *= 2) {
+            int stride = half / (2 * span);
+            for (int start = 0; start < half; start += 2 * span) {
+                for (int k = 0; k < span; k++) {
+                    const kiss_fft_cpx w = tables.twiddles[k * stride];
+                    kiss_fft_cpx &a = z[start + k];
+                    kiss_fft_cpx &b = z[start + k + span];
+                    float tr = b.r * w.r - b.i * w.i;
+                    float ti = b.r * w.i + b.i * w.r;
+                    b.r = a.r - tr;
+                    b.i = a.i - ti;
+                    a.r += tr;
+                    a.i += ti;
+                }
+            }
+        }
+
+        // Split the packed transform into the spectrum of the real input
+        bins[0] = kiss_fft_cpx{ (z[0].r + z[0].i) * scale_, 0.0f };
+        bins[half] = kiss_fft_cpx{ (z[0].r - z[0].i) * scale_, 0.0f };
+        for (int k = 1; k < half; k++) {
+            const kiss_fft_cpx a = z[k];
+            const kiss_fft_cpx b = z[half - k];
+            float even_r = 0.5f * (a.r + b.r);
+            float even_i = 0.5f * (a.i - b.i);
+            float odd_r = 0.5f * (a.i + b.i);
+            float odd_i = -0.5f * (a.r - b.r);
+            const kiss_fft_cpx w = tables.split_twiddles[k];
+            bins[k].r = (even_r + odd_r * w.r - odd_i * w.i) * scale_;
+            bins[k].i = (even_i + odd_r * w.i + odd_i * w.r) * scale_;
+        }
+    }
+
+    // Every frame of input, frame-major into output (frame_count(input.size()) * bin_count bins).
+    // Returns the number of frames written.
+    int process(std::span<const float> input, std::span<kiss_fft_cpx> output) const noexcept {
+        int frames = frame_count(input.size());
+        if (output.size() < static_cast<std::size_t>(frames) * bin_count) return 0;
+        for (int frame = 0; frame < frames; frame++) {
+            transform(input.subspan(static_cast<std::size_t>(frame) * Hop).template first<N>(),
+                      output.subspan(static_cast<std::size_t>(frame) * bin_count).template first<bin_count>());
+        }
+        return frames;
+    }
+
+private:
+    // Two radix-2 stages fused into twiddle-free 4-point codelets
+    static void radix4_first_stage(std::array<kiss_fft_cpx, half> &z) noexcept {
+        for (int start = 0; start < half; start += 4) {
+            kiss_fft_cpx a = z[start], b = z[start + 1], c = z[start + 2], d = z[start + 3];
+            float s0r = a.r + b.r, s0i = a.i + b.i;
+            float d0r = a.r - b.r, d0i = a.i - b.i;
+            float s1r = c.r + d.r, s1i = c.i + d.i;
+            float d1r = c.r - d.r, d1i = c.i - d.i;
+            // d1 * -i
+            z[start] = kiss_fft_cpx{ s0r + s1r, s0i + s1i };
+            z[start + 2] = kiss_fft_cpx{ s0r - s1r, s0i - s1i };
+            z[start + 1] = kiss_fft_cpx{ d0r + d1i, d0i - d1r };
+            z[start + 3] = kiss_fft_cpx{ d0r - d1i, d0i + d1r };
+        }
+    }
+
+    double sample_rate_;
+    ScalingType scaling_;
+    float scale_;
+};
+
+} // namespace stft
+
+#endif // STFT_FIXED_HPP
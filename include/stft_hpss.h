@@ -0,0 +1,48 @@
+#ifndef STFT_HPSS_H
+#define STFT_HPSS_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int harmonic_kernel;    // frames, odd; median along time
+    int percussive_kernel;  // bins, odd; median along frequency
+    float mask_power;       // soft-mask exponent, 2 gives Wiener-style masks
+} HPSSOptions;
+
+typedef struct HPSSStream HPSSStream;
+
+typedef struct {
+    bool success;
+    float *harmonic;
+    float *percussive;
+    int length;
+    char *message;
+} HPSSResult;
+
+
+HPSSOptions hpss_default_options(void);
+
+// Streaming separation of STFT frames. The time-direction median needs harmonic_kernel / 2
+// frames of look-ahead, so each push returns the frame that many frames behind the input.
+HPSSStream* hpss_stream_create(int bin_count, const HPSSOptions *options);
+int hpss_stream_latency(const HPSSStream *stream);
+// Returns 1 and writes the masked parts of the delayed frame, or 0 while the look-ahead fills.
+int hpss_stream_push(HPSSStream *stream, const kiss_fft_cpx *frame, kiss_fft_cpx *harmonic, kiss_fft_cpx *percussive);
+// Drains the look-ahead after the last frame; call until it returns 0.
+int hpss_stream_flush(HPSSStream *stream, kiss_fft_cpx *harmonic, kiss_fft_cpx *percussive);
+void hpss_stream_free(HPSSStream *stream);
+
+// STFT -> median-filter soft masks -> ISTFT of the harmonic and percussive parts
+HPSSResult* perform_hpss(const float *input_data, int input_length, const STFTParameters *params, const HPSSOptions *options);
+void hpss_free_result(HPSSResult *result);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_HPSS_H
@@ -0,0 +1,41 @@
+#ifndef STFT_PEAKS_H
+#define STFT_PEAKS_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    float frequency;    // Hz, from parabolic interpolation on log magnitude
+    float amplitude;    // interpolated linear magnitude
+    float phase;        // radians, interpolated between neighbouring bins
+} SpectralPeak;
+
+typedef struct {
+    bool success;
+    SpectralPeak *peaks;    // [frame * max_peaks + k], strongest first
+    int *peak_count;        // [frame], valid entries per frame (<= max_peaks)
+    int frame_count;
+    int max_peaks;
+    double frame_time;
+    char *message;
+} PeakResult;
+
+
+// Finds up to max_peaks strongest local maxima above min_db in one frame, strongest first.
+// scratch must hold bin_count floats and heap max_peaks ints; nothing is allocated.
+int stft_find_peaks(const kiss_fft_cpx *bins, int bin_count, double frequency_resolution, float min_db,
+                    int max_peaks, SpectralPeak *peaks, float *scratch, int *heap);
+
+// Runs the STFT and keeps only the top-K peaks of each frame; the spectrogram is never stored.
+PeakResult* perform_stft_peaks(const float *input_data, int input_length, const STFTParameters *params, int max_peaks, float min_db);
+void peaks_free_result(PeakResult *result);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_PEAKS_H
@@ -0,0 +1,43 @@
+#ifndef STFT_PITCH_H
+#define STFT_PITCH_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PITCH_MAX_CANDIDATES 8
+
+typedef struct {
+    double min_frequency;       // Hz, sets the longest lag searched
+    double max_frequency;       // Hz, sets the shortest lag searched
+    double threshold;           // YIN absolute threshold on the normalized difference
+    bool viterbi;               // smooth the track over per-frame candidates
+    double octave_cost;         // Viterbi cost per octave of pitch change between frames
+    double voicing_cost;        // Viterbi cost of switching between voiced and unvoiced
+} PitchOptions;
+
+typedef struct {
+    bool success;
+    float *frequency;           // [frame], 0 for unvoiced frames
+    float *periodicity;         // [frame], 1 - normalized difference at the chosen lag
+    int frame_count;
+    double frame_time;
+    char *message;
+} PitchResult;
+
+
+PitchOptions pitch_default_options(void);
+
+// YIN pitch tracking over the STFT framing of params (window_size samples every hop_size).
+// The difference function is computed from an FFT cross-correlation, O(N log N) per frame.
+PitchResult* perform_pitch_tracking(const float *input_data, int input_length, const STFTParameters *params, const PitchOptions *options);
+void pitch_free_result(PitchResult *result);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_PITCH_H
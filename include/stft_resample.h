@@ -0,0 +1,55 @@
+#ifndef STFT_RESAMPLE_H
+#define STFT_RESAMPLE_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming polyphase FIR resampler. The prototype is a Kaiser-windowed sinc cut off below the
+// lower of the two Nyquist rates; each output sample is one SIMD dot product of a filter phase
+// against contiguous input, so decimation never computes the samples it throws away. Filter
+// state carries over between process calls. Phase tables are built once per ratio and quality
+// and shared by every resampler using them.
+typedef struct STFTResampler STFTResampler;
+
+typedef struct {
+    int zero_crossings;     // sinc lobes on each side of the centre tap; filter length and latency grow with it
+    double cutoff;          // passband edge as a fraction of the lower Nyquist rate, in (0, 1]
+    double kaiser_beta;     // stopband attenuation: 8 gives about 80 dB
+} ResampleOptions;
+
+
+ResampleOptions resample_default_options(void);
+
+// up and down are reduced by their common divisor. Returns NULL for factors below 1 or
+// invalid options. options may be NULL for the defaults.
+STFTResampler* stft_resampler_create(int up, int down, const ResampleOptions *options);
+// Any ratio within a factor of 256: exact phases when output_rate / input_rate reduces to factors
+// up to 4096 (44.1 -> 16 kHz is 160 / 441), otherwise 256 phases per sample with linear
+// interpolation between neighbours.
+STFTResampler* stft_resampler_create_ratio(double input_rate, double output_rate, const ResampleOptions *options);
+// Upper bound on the samples one process call over count inputs can write
+int64_t stft_resampler_max_output(const STFTResampler *resampler, int count);
+// Consumes count samples and writes every output they complete; returns the number written.
+// Output k is aligned with input time k * down / up, so it lags the input by the filter's half length.
+int stft_resampler_process(STFTResampler *resampler, const float *input, int count, float *output);
+// Output length of a whole signal: ceil(input_length * up / down), which can pass INT_MAX
+int64_t stft_resampled_length(const STFTResampler *resampler, int input_length);
+// Resets, then converts a whole signal with the tail flushed through zeros; returns
+// stft_resampled_length samples written to output, or -1 without writing when that exceeds INT_MAX.
+int stft_resampler_resample(STFTResampler *resampler, const float *input, int input_length, float *output);
+// Outputs [first_output, first_output + count) of the whole-signal conversion, computed straight
+// from input without touching the streaming state; safe to call from several threads at once.
+void stft_resampler_render(const STFTResampler *resampler, const float *input, int input_length,
+                           int first_output, int count, float *output);
+void stft_resampler_reset(STFTResampler *resampler);
+void stft_resampler_free(STFTResampler *resampler);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_RESAMPLE_H
@@ -0,0 +1,65 @@
+#ifndef STFT_RING_H
+#define STFT_RING_H
+
+#include "stft.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free single-producer / single-consumer queue of fixed-size elements. Exactly one thread
+// may call the producer functions and one other thread the consumer functions; none of them
+// block or allocate.
+typedef struct STFTRing STFTRing;
+
+// Real-time analysis bridge: the audio thread pushes samples into a ring, a worker thread runs
+// a streaming STFT over them and publishes finished frames through a second ring.
+typedef struct STFTRealtime STFTRealtime;
+
+typedef struct {
+    uint64_t samples_pushed;
+    uint64_t samples_dropped;   // overrun: the sample ring was full when the audio thread pushed
+    uint64_t frames_published;
+    uint64_t frames_dropped;    // overrun: the frame ring was full, the consumer is behind
+    uint64_t underruns;         // stft_realtime_pop_frame found no frame waiting
+} STFTRealtimeStats;
+
+
+// capacity is rounded up to a power of two
+STFTRing* stft_ring_create(size_t capacity, size_t element_size);
+void stft_ring_free(STFTRing *ring);
+size_t stft_ring_capacity(const STFTRing *ring);
+
+// Producer side. write copies up to count elements and returns how many fit.
+size_t stft_ring_write(STFTRing *ring, const void *elements, size_t count);
+size_t stft_ring_write_available(STFTRing *ring);
+// Zero-copy: the next free slot or NULL if full; publish makes it visible to the consumer.
+void* stft_ring_write_slot(STFTRing *ring);
+void stft_ring_publish(STFTRing *ring);
+
+// Consumer side. read copies up to count elements and returns how many were taken.
+size_t stft_ring_read(STFTRing *ring, void *elements, size_t count);
+size_t stft_ring_read_available(STFTRing *ring);
+// Zero-copy: the oldest element or NULL if empty; release hands its slot back.
+const void* stft_ring_read_slot(STFTRing *ring);
+void stft_ring_release(STFTRing *ring);
+
+// sample_capacity and frame_capacity size the two rings. Starts the worker thread.
+STFTRealtime* stft_realtime_create(const STFTParameters *params, size_t sample_capacity, size_t frame_capacity);
+// Audio thread: returns the number of samples accepted; the rest are dropped and counted.
+int stft_realtime_push(STFTRealtime *realtime, const float *samples, int count);
+// Consumer thread: copies the oldest frame into bins (bin_count entries) and fills frame with
+// its index, start sample and gate flag (frame->bins points at bins). Returns 0 if none is ready.
+int stft_realtime_pop_frame(STFTRealtime *realtime, kiss_fft_cpx *bins, STFTFrame *frame);
+int stft_realtime_bin_count(const STFTRealtime *realtime);
+STFTRealtimeStats stft_realtime_stats(const STFTRealtime *realtime);
+// Stops and joins the worker; samples still in the ring are discarded.
+void stft_realtime_free(STFTRealtime *realtime);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_RING_H
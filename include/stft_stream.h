@@ -0,0 +1,37 @@
+#ifndef STFT_STREAM_H
+#define STFT_STREAM_H
+
+#include "stft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct STFTStream STFTStream;
+typedef struct STFTSynthesis STFTSynthesis;
+
+
+// Frame-by-frame analysis of an unbounded signal. All memory is allocated at creation;
+// pushing samples never allocates. With a resampling pre-stage its filter state carries across
+// pushes, frames are cut at the analysis rate, and output lags input by half the filter length.
+STFTStream* stft_stream_create(const STFTParameters *params);
+// Consumes count samples and calls callback for every frame they complete; returns the number of frames.
+int stft_stream_push(STFTStream *stream, const float *samples, int count, STFTFrameCallback callback, void *user_data);
+// Samples still needed before the next frame is emitted, counted at the analysis rate
+int stft_stream_samples_until_frame(const STFTStream *stream);
+void stft_stream_reset(STFTStream *stream);
+void stft_stream_free(STFTStream *stream);
+
+// Streaming weighted overlap-add, the inverse of STFTStream. Each pushed frame (scaled as the
+// analysis side scales it) completes hop_size output samples.
+STFTSynthesis* stft_synthesis_create(const STFTParameters *params);
+void stft_synthesis_push(STFTSynthesis *synthesis, const kiss_fft_cpx *bins, float *output);
+void stft_synthesis_reset(STFTSynthesis *synthesis);
+void stft_synthesis_free(STFTSynthesis *synthesis);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_STREAM_H
@@ -24,10 +24,26 @@
  4*4*4*2
  */
 
+/* generic butterflies that may run at once: the OpenMP path fans the top
+   stage (radix <= 5) out over threads */
+#ifdef _OPENMP
+#define KF_GENERIC_SLOTS 5
+#else
+#define KF_GENERIC_SLOTS 1
+#endif
+
 struct kiss_fft_state{
     int nfft;
     int inverse;
     int factors[2*MAXFACTORS];
+    int generic_radix;      /* largest radix above 5, or 0 */
+    kiss_fft_cpx * scratch; /* nfft for in-place calls, then generic butterfly scratch */
+    int four_step_rows;     /* N1 when run as an N1 x N2 four-step transform, else 0 */
+    kiss_fft_cfg col_cfg;   /* N1-point, for the four-step column pass */
+    kiss_fft_cfg row_cfg;   /* N2-point, for the four-step row pass */
+    kiss_fft_run_tasks run; /* runs large transforms' tasks, or NULL for the calling thread */
+    void * run_context;
+    int workers;
     kiss_fft_cpx twiddles[1];
 };
 
@@ -150,18 +166,5 @@ struct kiss_fft_state{
     KISS_FFT_DEBUG("%g + %gi\n",(double)((c)->r),(double)((c)->i))
 
 
-#ifdef KISS_FFT_USE_ALLOCA
-// define this to allow use of alloca instead of malloc for temporary buffers
-// Temporary buffers are used in two case:
-// 1. FFT sizes that have "bad" factors. i.e. not 2,3 and 5
-// 2. "in-place" FFTs.  Notice the quotes, since kissfft does not really do an in-place transform.
-#include <alloca.h>
-#define  KISS_FFT_TMP_ALLOC(nbytes) alloca(nbytes)
-#define  KISS_FFT_TMP_FREE(ptr)
-#else
-#define  KISS_FFT_TMP_ALLOC(nbytes) KISS_FFT_MALLOC(nbytes)
-#define  KISS_FFT_TMP_FREE(ptr) KISS_FFT_FREE(ptr)
-#endif
-
 #endif /* _kiss_fft_guts_h */
 
@@ -12,16 +12,36 @@
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
 
+/* Sizes from which kiss_fft_alloc plans a four-step transform, when the size has no
+   radix above 5. Below this the recursive engine's working set stays in cache. */
+#ifndef KISS_FFT_FOUR_STEP_MIN
+#define KISS_FFT_FOUR_STEP_MIN (1<<19)
+#endif
+/* Sizes from which the recursive engine splits one transform over a runner set with kiss_fft_set_parallel */
+#ifndef KISS_FFT_PARALLEL_MIN
+#define KISS_FFT_PARALLEL_MIN (1<<15)
+#endif
+#define KF_TASKS_PER_WORKER 4   /* slack for work stealing */
+#define KF_TILE 32              /* transpose tile edge, in complex values */
+#define KF_LINES_PER_TASK 16    /* columns or rows of the four-step handed to one task */
+
+/* Each butterfly combines legs u, u+m, ... for u in [u_begin, u_end), a
+   non-empty range, so a stage can be split across threads */
+
 static void kf_bfly2(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        int m
+        int m,
+        int u_begin,
+        int u_end
         )
 {
     kiss_fft_cpx * Fout2;
-    kiss_fft_cpx * tw1 = st->twiddles;
+    kiss_fft_cpx * tw1 = st->twiddles + u_begin*fstride;
     kiss_fft_cpx t;
+    int k = u_end - u_begin;
+    Fout += u_begin;
     Fout2 = Fout + m;
     do{
         C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
@@ -32,24 +52,29 @@ static void kf_bfly2(
         C_ADDTO( *Fout ,  t );
         ++Fout2;
         ++Fout;
-    }while (--m);
+    }while (--k);
 }
 
 static void kf_bfly4(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        const size_t m
+        const size_t m,
+        int u_begin,
+        int u_end
         )
 {
     kiss_fft_cpx *tw1,*tw2,*tw3;
     kiss_fft_cpx scratch[6];
-    size_t k=m;
+    size_t k=u_end-u_begin;
     const size_t m2=2*m;
     const size_t m3=3*m;
 
 
-    tw3 = tw2 = tw1 = st->twiddles;
+    tw1 = st->twiddles + u_begin*fstride;
+    tw2 = st->twiddles + u_begin*fstride*2;
+    tw3 = st->twiddles + u_begin*fstride*3;
+    Fout += u_begin;
 
     do {
         C_FIXDIV(*Fout,4); C_FIXDIV(Fout[m],4); C_FIXDIV(Fout[m2],4); C_FIXDIV(Fout[m3],4);
@@ -87,17 +112,21 @@ static void kf_bfly3(
          kiss_fft_cpx * Fout,
          const size_t fstride,
          const kiss_fft_cfg st,
-         size_t m
+         size_t m,
+         int u_begin,
+         int u_end
          )
 {
-     size_t k=m;
+     size_t k=u_end-u_begin;
      const size_t m2 = 2*m;
      kiss_fft_cpx *tw1,*tw2;
      kiss_fft_cpx scratch[5];
      kiss_fft_cpx epi3;
      epi3 = st->twiddles[fstride*m];
 
-     tw1=tw2=st->twiddles;
+     tw1 = st->twiddles + u_begin*fstride;
+     tw2 = st->twiddles + u_begin*fstride*2;
+     Fout += u_begin;
 
      do{
          C_FIXDIV(*Fout,3); C_FIXDIV(Fout[m],3); C_FIXDIV(Fout[m2],3);
@@ -131,7 +160,9 @@ static void kf_bfly5(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        int m
+        int m,
+        int u_begin,
+        int u_end
         )
 {
     kiss_fft_cpx *Fout0,*Fout1,*Fout2,*Fout3,*Fout4;
@@ -143,14 +174,14 @@ static void kf_bfly5(
     ya = twiddles[fstride*m];
     yb = twiddles[fstride*2*m];
 
-    Fout0=Fout;
+    Fout0=Fout+u_begin;
     Fout1=Fout0+m;
     Fout2=Fout0+2*m;
     Fout3=Fout0+3*m;
     Fout4=Fout0+4*m;
 
     tw=st->twiddles;
-    for ( u=0; u<m; ++u ) {
+    for ( u=u_begin; u<u_end; ++u ) {
         C_FIXDIV( *Fout0,5); C_FIXDIV( *Fout1,5); C_FIXDIV( *Fout2,5); C_FIXDIV( *Fout3,5); C_FIXDIV( *Fout4,5);
         scratch[0] = *Fout0;
 
@@ -188,13 +219,86 @@ static void kf_bfly5(
     }
 }
 
+/* 4-point DFT of a,b,c,d into y[0..3] */
+static void kf_dft4(kiss_fft_cpx * y, kiss_fft_cpx a, kiss_fft_cpx b, kiss_fft_cpx c, kiss_fft_cpx d, int inverse)
+{
+    kiss_fft_cpx t0, t1, t2, t3;
+    C_ADD(t0, a, c);
+    C_SUB(t1, a, c);
+    C_ADD(t2, b, d);
+    C_SUB(t3, b, d);
+    C_ADD(y[0], t0, t2);
+    C_SUB(y[2], t0, t2);
+    /* t3 * -i forward, * i inverse */
+    if (inverse) {
+        y[1].r = t1.r - t3.i;  y[1].i = t1.i + t3.r;
+        y[3].r = t1.r + t3.i;  y[3].i = t1.i - t3.r;
+    }else{
+        y[1].r = t1.r + t3.i;  y[1].i = t1.i - t3.r;
+        y[3].r = t1.r - t3.i;  y[3].i = t1.i + t3.r;
+    }
+}
+
+static void kf_bfly8(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        int m,
+        int u_begin,
+        int u_end
+        )
+{
+    /* twiddles[fstride*m] is e^(-+2 pi i / 8), whose parts are +-1/sqrt(2) */
+    const kiss_fft_scalar h = st->twiddles[fstride*m].r;
+    kiss_fft_cpx x[8], e[4], o[4], t;
+    int u, q, k;
+
+    for (u = u_begin; u < u_end; ++u) {
+        kiss_fft_cpx * F = Fout + u;
+        for (q = 0; q < 8; ++q) {
+            x[q] = F[q*m];
+            C_FIXDIV(x[q],8);
+        }
+        /* the first butterfly of every group has unit twiddles */
+        if (u) {
+            for (q = 1; q < 8; ++q) {
+                C_MUL(t, x[q], st->twiddles[(size_t)q*u*fstride]);
+                x[q] = t;
+            }
+        }
+
+        kf_dft4(e, x[0], x[2], x[4], x[6], st->inverse);
+        kf_dft4(o, x[1], x[3], x[5], x[7], st->inverse);
+
+        /* o[k] *= W8^k; W8^1 and W8^3 are (1 -+ i)/sqrt(2) and (-1 -+ i)/sqrt(2),
+           W8^2 is -+i, so the only multiplies are by h */
+        if (st->inverse) {
+            t.r = S_MUL(o[1].r - o[1].i, h);  t.i = S_MUL(o[1].r + o[1].i, h);  o[1] = t;
+            t.r = -o[2].i;  t.i = o[2].r;  o[2] = t;
+            t.r = -S_MUL(o[3].r + o[3].i, h);  t.i = S_MUL(o[3].r - o[3].i, h);  o[3] = t;
+        }else{
+            t.r = S_MUL(o[1].r + o[1].i, h);  t.i = S_MUL(o[1].i - o[1].r, h);  o[1] = t;
+            t.r = o[2].i;  t.i = -o[2].r;  o[2] = t;
+            t.r = S_MUL(o[3].i - o[3].r, h);  t.i = -S_MUL(o[3].r + o[3].i, h);  o[3] = t;
+        }
+
+        for (k = 0; k < 4; ++k) {
+            C_ADD(F[k*m], e[k], o[k]);
+            C_SUB(F[(k+4)*m], e[k], o[k]);
+        }
+    }
+}
+
 /* perform the butterfly for one stage of a mixed radix FFT */
 static void kf_bfly_generic(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
         int m,
-        int p
+        int p,
+        int u_begin,
+        int u_end,
+        kiss_fft_cpx * scratch
         )
 {
     int u,k,q1,q;
@@ -202,13 +306,7 @@ static void kf_bfly_generic(
     kiss_fft_cpx t;
     int Norig = st->nfft;
 
-    kiss_fft_cpx * scratch = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx)*p);
-    if (scratch == NULL){
-        KISS_FFT_ERROR("Memory allocation failed.");
-        return;
-    }
-
-    for ( u=0; u<m; ++u ) {
+    for ( u=u_begin; u<u_end; ++u ) {
         k=u;
         for ( q1=0 ; q1<p ; ++q1 ) {
             scratch[q1] = Fout[ k  ];
@@ -229,7 +327,27 @@ static void kf_bfly_generic(
             k += m;
         }
     }
-    KISS_FFT_TMP_FREE(scratch);
+}
+
+static void kf_bfly(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        int m,
+        int p,
+        int u_begin,
+        int u_end,
+        kiss_fft_cpx * scratch
+        )
+{
+    switch (p) {
+        case 2: kf_bfly2(Fout,fstride,st,m,u_begin,u_end); break;
+        case 3: kf_bfly3(Fout,fstride,st,m,u_begin,u_end); break;
+        case 4: kf_bfly4(Fout,fstride,st,m,u_begin,u_end); break;
+        case 5: kf_bfly5(Fout,fstride,st,m,u_begin,u_end); break;
+        case 8: kf_bfly8(Fout,fstride,st,m,u_begin,u_end); break;
+        default: kf_bfly_generic(Fout,fstride,st,m,p,u_begin,u_end,scratch); break;
+    }
 }
 
 static
@@ -239,7 +357,8 @@ void kf_work(
         const size_t fstride,
         int in_stride,
         int * factors,
-        const kiss_fft_cfg st
+        const kiss_fft_cfg st,
+        kiss_fft_cpx * scratch
         )
 {
     kiss_fft_cpx * Fout_beg=Fout;
@@ -257,16 +376,11 @@ void kf_work(
         // execute the p different work units in different threads
 #       pragma omp parallel for
         for (k=0;k<p;++k)
-            kf_work( Fout +k*m, f+ fstride*in_stride*k,fstride*p,in_stride,factors,st);
+            kf_work( Fout +k*m, f+ fstride*in_stride*k,fstride*p,in_stride,factors,st,
+                     scratch + k*st->generic_radix);
         // all threads have joined by this point
 
-        switch (p) {
-            case 2: kf_bfly2(Fout,fstride,st,m); break;
-            case 3: kf_bfly3(Fout,fstride,st,m); break;
-            case 4: kf_bfly4(Fout,fstride,st,m); break;
-            case 5: kf_bfly5(Fout,fstride,st,m); break;
-            default: kf_bfly_generic(Fout,fstride,st,m,p); break;
-        }
+        kf_bfly(Fout,fstride,st,m,p,0,m,scratch);
         return;
     }
 #endif
@@ -282,7 +396,7 @@ void kf_work(
             // DFT of size m*p performed by doing
             // p instances of smaller DFTs of size m,
             // each one takes a decimated version of the input
-            kf_work( Fout , f, fstride*p, in_stride, factors,st);
+            kf_work( Fout , f, fstride*p, in_stride, factors,st,scratch);
             f += fstride*in_stride;
         }while( (Fout += m) != Fout_end );
     }
@@ -290,15 +404,194 @@ void kf_work(
     Fout=Fout_beg;
 
     // recombine the p smaller DFTs
-    switch (p) {
-        case 2: kf_bfly2(Fout,fstride,st,m); break;
-        case 3: kf_bfly3(Fout,fstride,st,m); break;
-        case 4: kf_bfly4(Fout,fstride,st,m); break;
-        case 5: kf_bfly5(Fout,fstride,st,m); break;
-        default: kf_bfly_generic(Fout,fstride,st,m,p); break;
+    kf_bfly(Fout,fstride,st,m,p,0,m,scratch);
+}
+
+/*  Intra-transform parallelism for the recursive engine. The top `levels`
+    stages are unrolled: their `leaves` sub-transforms (leaf L reads input
+    L, L+leaves, ...) run as independent tasks, then each unrolled stage is
+    recombined with its groups' butterfly ranges spread over the tasks.
+    Only used for sizes without generic radices, so tasks need no scratch. */
+typedef struct {
+    kiss_fft_cfg st;
+    const kiss_fft_cpx * fin;
+    kiss_fft_cpx * fout;
+    int in_stride;
+    int levels;
+    int leaves;
+    int level;      /* stage being recombined, or -1 for the leaf pass */
+    int groups;     /* independent butterfly groups in that stage */
+    int chunks;     /* butterfly ranges per group */
+} kf_parallel_job;
+
+static void kf_parallel_task(void * arg, int task, int worker)
+{
+    const kf_parallel_job * job = (const kf_parallel_job *)arg;
+    kiss_fft_cfg st = job->st;
+    int * factors = st->factors;
+    (void)worker;
+
+    if (job->level < 0) {
+        size_t offset = 0;
+        int digits = task;
+        int j;
+        for (j = 0; j < job->levels; ++j) {
+            offset += (size_t)(digits % factors[2*j]) * factors[2*j+1];
+            digits /= factors[2*j];
+        }
+        kf_work(job->fout + offset, job->fin + (size_t)task*job->in_stride, job->leaves,
+                job->in_stride, factors + 2*job->levels, st, NULL);
+    }else{
+        const int p = factors[2*job->level];
+        const int m = factors[2*job->level+1];
+        const int group = task / job->chunks;
+        const int chunk = task % job->chunks;
+        kf_bfly(job->fout + (size_t)group*p*m, job->groups, st, m, p,
+                (int)((long long)m*chunk/job->chunks), (int)((long long)m*(chunk+1)/job->chunks), NULL);
+    }
+}
+
+static void kf_run(kiss_fft_cfg st, int tasks, kiss_fft_task task, void * arg)
+{
+    int i;
+    if (st->run) {
+        st->run(st->run_context, tasks, task, arg);
+        return;
+    }
+    for (i = 0; i < tasks; ++i)
+        task(arg, i, 0);
+}
+
+static void kf_work_parallel(kiss_fft_cfg st, const kiss_fft_cpx * fin, kiss_fft_cpx * fout, int in_stride)
+{
+    const int target = KF_TASKS_PER_WORKER * st->workers;
+    kf_parallel_job job;
+
+    job.st = st;
+    job.fin = fin;
+    job.fout = fout;
+    job.in_stride = in_stride;
+    job.levels = 0;
+    job.leaves = 1;
+    while (job.leaves < target && st->factors[2*job.levels+1] > 1)
+        job.leaves *= st->factors[2*job.levels++];
+
+    job.level = -1;
+    kf_run(st, job.leaves, kf_parallel_task, &job);
+
+    job.groups = job.leaves;
+    for (job.level = job.levels - 1; job.level >= 0; --job.level) {
+        const int m = st->factors[2*job.level+1];
+        job.groups /= st->factors[2*job.level];
+        job.chunks = (target + job.groups - 1) / job.groups;
+        if (job.chunks > m)
+            job.chunks = m;
+        kf_run(st, job.groups * job.chunks, kf_parallel_task, &job);
+    }
+}
+
+/*  Four-step (Bailey) transform of N = N1*N2 points, with n = n1*N2 + n2 and
+    k = k1 + k2*N1:
+      1. N2 column FFTs of length N1, read with stride N2, then twiddle by W_N^(n2*k1)
+      2. transpose to N1 rows of N2
+      3. N1 row FFTs of length N2
+      4. transpose to k2-major order
+    Every pass streams through memory in KF_TILE or KF_LINES_PER_TASK sized blocks, so
+    the working set stays in cache however large N is. Passes run on the cfg's task runner. */
+typedef struct {
+    kiss_fft_cfg st;
+    const kiss_fft_cpx * fin;
+    kiss_fft_cpx * fout;
+    int in_stride;
+    int pass;
+} kf_four_step_job;
+
+static void kf_transpose_rows(kiss_fft_cpx * dst, const kiss_fft_cpx * src,
+                              int rows, int cols, int row_begin, int row_end)
+{
+    int rb, cb, r, c;
+    for (rb = row_begin; rb < row_end; rb += KF_TILE) {
+        int r_end = rb + KF_TILE < row_end ? rb + KF_TILE : row_end;
+        for (cb = 0; cb < cols; cb += KF_TILE) {
+            int c_end = cb + KF_TILE < cols ? cb + KF_TILE : cols;
+            for (r = rb; r < r_end; ++r)
+                for (c = cb; c < c_end; ++c)
+                    dst[(size_t)c*rows + r] = src[(size_t)r*cols + c];
+        }
+    }
+}
+
+static void kf_four_step_task(void * arg, int task, int worker)
+{
+    const kf_four_step_job * job = (const kf_four_step_job *)arg;
+    kiss_fft_cfg st = job->st;
+    kiss_fft_cfg col = st->col_cfg;
+    kiss_fft_cfg row = st->row_cfg;
+    const int n1 = st->four_step_rows;
+    const int n2 = st->nfft / n1;
+    kiss_fft_cpx * work = st->scratch;
+    int begin = task * KF_LINES_PER_TASK;
+    int i, k;
+    (void)worker;
+
+    switch (job->pass) {
+        case 0:
+            for (i = begin; i < begin + KF_LINES_PER_TASK && i < n2; ++i) {
+                kiss_fft_cpx * out = work + (size_t)i*n1;
+                kf_work(out, job->fin + (size_t)i*job->in_stride, 1, job->in_stride*n2,
+                        col->factors, col, col->scratch + col->nfft);
+                for (k = 1; k < n1; ++k) {
+                    kiss_fft_cpx t;
+                    C_MUL(t, out[k], st->twiddles[(size_t)i*k]);
+                    out[k] = t;
+                }
+            }
+            break;
+        case 1:
+            kf_transpose_rows(job->fout, work, n2, n1, begin,
+                              begin + KF_LINES_PER_TASK < n2 ? begin + KF_LINES_PER_TASK : n2);
+            break;
+        case 2:
+            for (i = begin; i < begin + KF_LINES_PER_TASK && i < n1; ++i)
+                kf_work(work + (size_t)i*n2, job->fout + (size_t)i*n2, 1, 1,
+                        row->factors, row, row->scratch + row->nfft);
+            break;
+        default:
+            kf_transpose_rows(job->fout, work, n1, n2, begin,
+                              begin + KF_LINES_PER_TASK < n1 ? begin + KF_LINES_PER_TASK : n1);
+            break;
+    }
+}
+
+static void kf_four_step(kiss_fft_cfg st, const kiss_fft_cpx * fin, kiss_fft_cpx * fout, int in_stride)
+{
+    /* fin is fully consumed by pass 0, so fin == fout needs no extra buffer */
+    const int n1 = st->four_step_rows;
+    const int n2 = st->nfft / n1;
+    const int lines[4] = { n2, n2, n1, n1 };
+    kf_four_step_job job;
+    int pass;
+
+    job.st = st;
+    job.fin = fin;
+    job.fout = fout;
+    job.in_stride = in_stride;
+    for (pass = 0; pass < 4; ++pass) {
+        int tasks = (lines[pass] + KF_LINES_PER_TASK - 1) / KF_LINES_PER_TASK;
+        job.pass = pass;
+        kf_run(st, tasks, kf_four_step_task, &job);
     }
 }
 
+/* Largest divisor of n not above sqrt(n) */
+static int kf_four_step_split(int n)
+{
+    int d = (int)floor(sqrt((double)n));
+    while (d > 1 && n % d)
+        --d;
+    return d;
+}
+
 /*  facbuf is populated by p1,m1,p2,m2, ...
     where
     p[i] * m[i] = m[i-1]
@@ -310,6 +603,31 @@ void kf_factor(int n,int * facbuf)
     double floor_sqrt;
     floor_sqrt = floor( sqrt((double)n) );
 
+    /* powers of two: radix 8, with any 4*4 or 4 (rather than 8*2 or 2) as the
+       outer stages, which measured faster than leaving them innermost */
+    if (n >= 8 && (n & (n-1)) == 0) {
+        int bits = 0, eights, fours;
+        while ((1 << bits) < n)
+            ++bits;
+        eights = bits / 3;
+        fours = bits % 3 == 2 ? 1 : 0;
+        if (bits % 3 == 1) {
+            --eights;
+            fours = 2;
+        }
+        while (fours--) {
+            n /= 4;
+            *facbuf++ = 4;
+            *facbuf++ = n;
+        }
+        while (eights--) {
+            n /= 8;
+            *facbuf++ = 8;
+            *facbuf++ = n;
+        }
+        return;
+    }
+
     /*factor out powers of 4, powers of 2, then any remaining primes */
     do {
         while (n % p) {
@@ -339,8 +657,42 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
     KISS_FFT_ALIGN_CHECK(mem)
 
     kiss_fft_cfg st=NULL;
-    size_t memneeded = KISS_FFT_ALIGN_SIZE_UP(sizeof(struct kiss_fft_state)
-        + sizeof(kiss_fft_cpx)*(nfft-1)); /* twiddle factors*/
+    int factors[2*MAXFACTORS];
+    int generic_radix = 0;
+    size_t scratch_len;
+    size_t memneeded;
+    size_t base_size;
+    size_t col_size = 0, row_size = 0;
+    int four_step_rows = 0;
+    int i;
+
+    /* scratch lives in the cfg so that no transform touches the allocator:
+       nfft entries for in-place calls, and one radix's worth for each
+       concurrent generic butterfly */
+    kf_factor(nfft,factors);
+    i = 0;
+    do {
+        if (factors[2*i] > 5 && factors[2*i] != 8 && factors[2*i] > generic_radix)
+            generic_radix = factors[2*i];
+    } while (factors[2*i++ + 1] != 1);
+    scratch_len = (size_t)nfft + (size_t)generic_radix * KF_GENERIC_SLOTS;
+
+    /* large sizes with only radices 2-5 run as four steps; the column and
+       row cfgs are placed after this one's twiddles and scratch */
+    if (nfft >= KISS_FFT_FOUR_STEP_MIN && generic_radix == 0) {
+        four_step_rows = kf_four_step_split(nfft);
+        if (four_step_rows < KF_TILE) {
+            four_step_rows = 0;
+        } else {
+            kiss_fft_alloc(four_step_rows, inverse_fft, NULL, &col_size);
+            kiss_fft_alloc(nfft / four_step_rows, inverse_fft, NULL, &row_size);
+        }
+    }
+
+    base_size = KISS_FFT_ALIGN_SIZE_UP(sizeof(struct kiss_fft_state)
+        + sizeof(kiss_fft_cpx)*(nfft-1)  /* twiddle factors*/
+        + sizeof(kiss_fft_cpx)*scratch_len);
+    memneeded = base_size + col_size + row_size;
 
     if ( lenmem==NULL ) {
         st = ( kiss_fft_cfg)KISS_FFT_MALLOC( memneeded );
@@ -350,9 +702,21 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
         *lenmem = memneeded;
     }
     if (st) {
-        int i;
         st->nfft=nfft;
         st->inverse = inverse_fft;
+        st->generic_radix = generic_radix;
+        st->scratch = st->twiddles + nfft;
+        st->four_step_rows = four_step_rows;
+        st->col_cfg = NULL;
+        st->row_cfg = NULL;
+        st->run = NULL;
+        st->run_context = NULL;
+        st->workers = 1;
+        if (four_step_rows) {
+            st->col_cfg = kiss_fft_alloc(four_step_rows, inverse_fft, (char *)st + base_size, &col_size);
+            st->row_cfg = kiss_fft_alloc(nfft / four_step_rows, inverse_fft,
+                                         (char *)st + base_size + col_size, &row_size);
+        }
 
         for (i=0;i<nfft;++i) {
             const double pi=3.141592653589793238462643383279502884197169399375105820974944;
@@ -362,7 +726,7 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
             kf_cexp(st->twiddles+i, phase );
         }
 
-        kf_factor(nfft,st->factors);
+        memcpy(st->factors,factors,sizeof(factors));
     }
     return st;
 }
@@ -370,27 +734,37 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
 
 void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
 {
-    if (fin == fout) {
+    kiss_fft_cpx * generic_scratch = st->scratch + st->nfft;
+
+    if (st->four_step_rows) {
+        kf_four_step(st, fin, fout, in_stride);
+    }else if (st->run && st->workers > 1) {
+        /* set only for sizes of at least KISS_FFT_PARALLEL_MIN without generic radices */
+        kiss_fft_cpx * out = fin == fout ? st->scratch : fout;
+        kf_work_parallel(st, fin, out, in_stride);
+        if (out != fout)
+            memcpy(fout,out,sizeof(kiss_fft_cpx)*st->nfft);
+    }else if (fin == fout) {
         //NOTE: this is not really an in-place FFT algorithm.
-        //It just performs an out-of-place FFT into a temp buffer
+        //It performs an out-of-place FFT into the cfg's scratch buffer
         if (fout == NULL){
             KISS_FFT_ERROR("fout buffer NULL.");
         return;
         }
 
-        kiss_fft_cpx * tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
-        if (tmpbuf == NULL){
-            KISS_FFT_ERROR("Memory allocation error.");
-        return;
-        }
-
-
-
-        kf_work(tmpbuf,fin,1,in_stride, st->factors,st);
-        memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx)*st->nfft);
-        KISS_FFT_TMP_FREE(tmpbuf);
+        kf_work(st->scratch,fin,1,in_stride, st->factors,st,generic_scratch);
+        memcpy(fout,st->scratch,sizeof(kiss_fft_cpx)*st->nfft);
     }else{
-        kf_work( fout, fin, 1,in_stride, st->factors,st );
+        kf_work( fout, fin, 1,in_stride, st->factors,st,generic_scratch );
+    }
+}
+
+void kiss_fft_set_parallel(kiss_fft_cfg cfg, kiss_fft_run_tasks run, void * context, int workers)
+{
+    if (cfg->generic_radix == 0 && cfg->nfft >= KISS_FFT_PARALLEL_MIN) {
+        cfg->run = run;
+        cfg->run_context = context;
+        cfg->workers = run && workers > 1 ? workers : 1;
     }
 }
 
@@ -112,6 +112,16 @@ typedef struct kiss_fft_state* kiss_fft_cfg;
  *  If lenmem is not NULL and ( mem is NULL or *lenmem is not large enough),
  *      then the function returns NULL and places the minimum cfg 
  *      buffer size in *lenmem.
+ *
+ *  The cfg also holds the scratch used by in-place calls (fin == fout) and
+ *  by radices other than 2, 3, 4 and 5, so no transform allocates. As with
+ *  kiss_fftr, a cfg must therefore not be used by two threads at once.
+ *
+ *  Sizes of at least KISS_FFT_FOUR_STEP_MIN (2^19) with no factor above 5
+ *  are planned as cache-blocked four-step transforms. From
+ *  KISS_FFT_PARALLEL_MIN (2^15), such sizes can split each transform into
+ *  tasks handed to a runner attached with kiss_fft_set_parallel. A new cfg
+ *  has no runner and never starts threads.
  * */
 
 kiss_fft_cfg KISS_FFT_API kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem);
@@ -133,6 +143,21 @@ void KISS_FFT_API kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx
  * */
 void KISS_FFT_API kiss_fft_stride(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int fin_stride);
 
+/*
+ * kiss_fft_set_parallel(cfg,run,context,workers)
+ *
+ * Lets a large transform (at least KISS_FFT_PARALLEL_MIN points, no factor
+ * above 5) split into tasks. run(context,count,task,arg) must call
+ * task(arg,i,worker) once for each i in [0,count), on any threads, and
+ * return when all have finished; workers is how many can run at once and
+ * sizes the split. A NULL run executes on the calling thread. Smaller sizes
+ * ignore this. Callers that already run many transforms in parallel, such
+ * as an STFT over frames, should leave it unset.
+ */
+typedef void (*kiss_fft_task)(void *arg, int index, int worker);
+typedef void (*kiss_fft_run_tasks)(void *context, int count, kiss_fft_task task, void *arg);
+void KISS_FFT_API kiss_fft_set_parallel(kiss_fft_cfg cfg, kiss_fft_run_tasks run, void *context, int workers);
+
 /* If kiss_fft_alloc allocated a buffer, it is one contiguous 
    buffer and can be simply free()d when no longer needed*/
 #define kiss_fft_free KISS_FFT_FREE
@@ -1,8 +1,17 @@
+#define _XOPEN_SOURCE 700
 #include "../include/stft.h"
+#include "stft_internal.h"
+#include "stft_pool.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 STFTParameters stft_create_parameters(int window_size, int hop_size, double sample_rate, WindowType window_type, ScalingType scaling) {
     STFTParameters params = {
         .window_size = window_size,
@@ -27,213 +36,1084 @@ char* stft_validate_parameters(const STFTParameters *params) {
     if (params->sample_rate <= 0) {
         return strdup("Sample rate must be greater than 0");
     }
+    if (params->resample_up < 0 || params->resample_down < 0) {
+        return strdup("Resampling factors must not be negative");
+    }
+    if (params->resample_up > STFT_MAX_RESAMPLE_FACTOR || params->resample_down > STFT_MAX_RESAMPLE_FACTOR) {
+        return strdup("Resampling factors must be at most 4096");
+    }
+    if (params->target_sample_rate < 0) {
+        return strdup("Target sample rate must not be negative");
+    }
+    if (params->target_sample_rate > 0 && (params->resample_up > 1 || params->resample_down > 1)) {
+        return strdup("Set either target_sample_rate or resample_up/down, not both");
+    }
+    if (params->target_sample_rate > 0 && (params->target_sample_rate > params->sample_rate * STFT_MAX_RESAMPLE_RATIO ||
+                                           params->target_sample_rate * STFT_MAX_RESAMPLE_RATIO < params->sample_rate)) {
+        return strdup("Target sample rate must be within a factor of 256 of the sample rate");
+    }
     return NULL;
 }
 
+// 0 and 1 both mean no change
+static int resample_factor(int factor) {
+    return factor > 1 ? factor : 1;
+}
+
+double stft_analysis_rate(const STFTParameters *params) {
+    if (params->target_sample_rate > 0) return params->target_sample_rate;
+    return params->sample_rate * resample_factor(params->resample_up) / resample_factor(params->resample_down);
+}
+
 double stft_get_frame_time(const STFTParameters *params) {
-    return (double)params->hop_size / params->sample_rate;
+    return (double)params->hop_size / stft_analysis_rate(params);
 }
 
 double stft_get_frequency_resolution(const STFTParameters *params) {
-    return params->sample_rate / params->window_size;
+    return stft_analysis_rate(params) / params->window_size;
 }
 
 double stft_get_overlap_percentage(const STFTParameters *params) {
     return 100.0 * (1.0 - (double)params->hop_size / params->window_size);
 }
 
-float* generate_hann_window(int window_size) {
-    float *window = (float*)malloc(window_size * sizeof(float));
-    if (!window) return NULL;
-    
+static void fill_hann_window(float *window, int window_size) {
     // Calculate window coefficients (symmetric Hann window like scipy)
     for (int n = 0; n < window_size; n++) {
         window[n] = 0.5f * (1.0f - cosf(2.0f * M_PI * n / window_size));
     }
     
     // No normalization here - will be handled in scaling calculation
+}
+
+float* generate_hann_window(int window_size) {
+    float *window = (float*)malloc(window_size * sizeof(float));
+    if (!window) return NULL;
+    
+    fill_hann_window(window, window_size);
     return window;
 }
 
-float* generate_window(WindowType window_type, int window_size) {
+void stft_fill_window(WindowType window_type, int window_size, float *window) {
     switch (window_type) {
         case WINDOW_HANN:
-            return generate_hann_window(window_size);
+            fill_hann_window(window, window_size);
+            break;
         default:
-            return generate_hann_window(window_size);
+            fill_hann_window(window, window_size);
+            break;
     }
 }
 
-STFTResult* perform_stft(const float *input_data, int input_length, const STFTParameters *params) {
-    STFTResult *result = (STFTResult*)calloc(1, sizeof(STFTResult));
-    if (!result) return NULL;
+float* generate_window(WindowType window_type, int window_size) {
+    float *window = (float*)malloc(window_size * sizeof(float));
+    if (!window) return NULL;
     
-    char *validation_error = stft_validate_parameters(params);
-    if (validation_error) {
-        result->success = false;
-        result->message = validation_error;
-        return result;
+    stft_fill_window(window_type, window_size, window);
+    return window;
+}
+
+// Scipy-compatible scale factor applied to every FFT bin
+float stft_window_scale(const STFTParameters *params, const float *window) {
+    float window_sum = 0.0f;
+    float window_sum_sq = 0.0f;
+    for (int i = 0; i < params->window_size; i++) {
+        window_sum += window[i];
+        window_sum_sq += window[i] * window[i];
     }
     
-    int window_size = params->window_size;
-    int hop_size = params->hop_size;
-    
-    if (input_length < window_size) {
-        result->success = false;
-        result->message = strdup("Input data too short for window size");
-        return result;
+    if (params->scaling == SCALING_SPECTRUM) {
+        return 1.0f / (window_sum * window_sum);
+    }
+    // SCALING_PSD
+    return 1.0f / (stft_analysis_rate(params) * window_sum_sq);
+}
+
+int64_t stft_get_analysis_length(const STFTParameters *params, int input_length) {
+    if (!stft_resamples(params) || input_length <= 0) return input_length;
+    return stft_params_resampled_length(params, input_length);
+}
+
+// Frames in analysis_length samples that are already at the analysis rate; none past INT_MAX,
+// where analysis refuses the input
+static int analysis_frame_count(const STFTParameters *params, int64_t analysis_length) {
+    if (analysis_length < params->window_size || analysis_length > INT_MAX) return 0;
+    return ((int)analysis_length - params->window_size) / params->hop_size + 1;
+}
+
+int stft_get_frame_count(const STFTParameters *params, int input_length) {
+    return analysis_frame_count(params, stft_get_analysis_length(params, input_length));
+}
+
+static void* default_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void default_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const STFTAllocator default_allocator = { default_alloc, default_free, NULL, NULL };
+
+const STFTAllocator* stft_default_allocator(void) {
+    return &default_allocator;
+}
+
+// NULL or zero-initialized allocators mean malloc/free
+static const STFTAllocator* resolve_allocator(const STFTAllocator *allocator) {
+    return allocator && allocator->alloc && allocator->free ? allocator : &default_allocator;
+}
+
+void* stft_mem_alloc(const STFTAllocator *allocator, size_t size) {
+    allocator = resolve_allocator(allocator);
+    return allocator->alloc(allocator->ctx, size);
+}
+
+void* stft_mem_calloc(const STFTAllocator *allocator, size_t count, size_t size) {
+    void *ptr = stft_mem_alloc(allocator, count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void stft_mem_free(const STFTAllocator *allocator, void *ptr) {
+    if (!ptr) return;
+    allocator = resolve_allocator(allocator);
+    allocator->free(allocator->ctx, ptr);
+}
+
+char* stft_mem_strdup(const STFTAllocator *allocator, const char *text) {
+    size_t length = strlen(text) + 1;
+    char *copy = (char*)stft_mem_alloc(allocator, length);
+    if (copy) memcpy(copy, text, length);
+    return copy;
+}
+
+void* stft_mem_aligned_alloc(const STFTAllocator *allocator, size_t size) {
+    allocator = resolve_allocator(allocator);
+    if (allocator->aligned_alloc) {
+        return allocator->aligned_alloc(allocator->ctx, size, STFT_ALIGNMENT);
     }
     
-    float *window = generate_window(params->window_type, window_size);
-    if (!window) {
-        result->success = false;
-        result->message = strdup("Failed to generate window function");
-        return result;
+    // Over-allocate and keep the raw pointer just below the aligned block
+    void *raw = allocator->alloc(allocator->ctx, size + STFT_ALIGNMENT + sizeof(void*));
+    if (!raw) return NULL;
+    
+    uintptr_t aligned = ((uintptr_t)raw + sizeof(void*) + STFT_ALIGNMENT - 1) & ~(uintptr_t)(STFT_ALIGNMENT - 1);
+    ((void**)aligned)[-1] = raw;
+    return (void*)aligned;
+}
+
+void stft_mem_aligned_free(const STFTAllocator *allocator, void *ptr) {
+    if (!ptr) return;
+    allocator = resolve_allocator(allocator);
+    allocator->free(allocator->ctx, allocator->aligned_alloc ? ptr : ((void**)ptr)[-1]);
+}
+
+char* stft_engine_init(STFTFrameEngine *engine, const STFTParameters *params, const STFTAllocator *allocator) {
+    memset(engine, 0, sizeof(STFTFrameEngine));
+    engine->allocator = *resolve_allocator(allocator);
+    engine->window_size = params->window_size;
+    engine->bin_count = params->window_size / 2 + 1;
+    
+    engine->window = (float*)stft_mem_aligned_alloc(&engine->allocator, params->window_size * sizeof(float));
+    if (!engine->window) {
+        return strdup("Failed to generate window function");
     }
+    stft_fill_window(params->window_type, params->window_size, engine->window);
     
-    // Calculate window scaling factors for scipy compatibility
-    float window_sum = 0.0f;
+    // Scaling is folded into the window, so the FFT output needs no pass of its own
+    float scale = stft_window_scale(params, engine->window);
     float window_sum_sq = 0.0f;
-    for (int i = 0; i < window_size; i++) {
-        window_sum += window[i];
-        window_sum_sq += window[i] * window[i];
+    for (int i = 0; i < params->window_size; i++) {
+        engine->window[i] *= scale;
+        window_sum_sq += engine->window[i] * engine->window[i];
     }
     
-    int frame_count = (input_length - window_size) / hop_size + 1;
-    int frequency_bin_count = window_size / 2 + 1;
+    engine->gate_energy = -1.0f;
+    if (params->energy_gate) {
+        // Compare the raw sum of windowed squares so no log is needed per frame
+        engine->gate_energy = (float)(pow(10.0, params->gate_threshold_db / 10.0) * window_sum_sq);
+    }
     
-    result->spectrogram_data = (kiss_fft_cpx**)malloc(frame_count * sizeof(kiss_fft_cpx*));
-    if (!result->spectrogram_data) {
-        free(window);
-        result->success = false;
-        result->message = strdup("Failed to allocate spectrogram memory");
-        return result;
+    // Size query first, then place the twiddle tables in allocator memory
+    bool real_input = params->window_size % 2 == 0;
+    size_t cfg_size = 0;
+    if (real_input) {
+        kiss_fftr_alloc(params->window_size, 0, NULL, &cfg_size);
+    } else {
+        kiss_fft_alloc(params->window_size, 0, NULL, &cfg_size);
+    }
+    void *cfg_memory = stft_mem_alloc(&engine->allocator, cfg_size);
+    if (cfg_memory && real_input) {
+        engine->real_cfg = kiss_fftr_alloc(params->window_size, 0, cfg_memory, &cfg_size);
+    } else if (cfg_memory) {
+        engine->cfg = kiss_fft_alloc(params->window_size, 0, cfg_memory, &cfg_size);
+    }
+    if (!engine->real_cfg && !engine->cfg) {
+        stft_mem_free(&engine->allocator, cfg_memory);
+        stft_engine_destroy(engine);
+        return strdup("Failed to allocate FFT configuration");
+    }
+    // The real FFT reads the windowed frame as window_size / 2 packed (even, odd) pairs
+    size_t input_bytes = real_input ? params->window_size * sizeof(float) : params->window_size * sizeof(kiss_fft_cpx);
+    engine->fft_input = (kiss_fft_cpx*)stft_mem_alloc(&engine->allocator, input_bytes);
+    engine->fft_input_next = (kiss_fft_cpx*)stft_mem_alloc(&engine->allocator, input_bytes);
+    engine->fft_output = (kiss_fft_cpx*)stft_mem_alloc(&engine->allocator, params->window_size * sizeof(kiss_fft_cpx));
+    if (!engine->fft_input || !engine->fft_input_next || !engine->fft_output) {
+        stft_engine_destroy(engine);
+        return strdup("Failed to allocate FFT buffers");
     }
     
-    for (int frame = 0; frame < frame_count; frame++) {
-        result->spectrogram_data[frame] = (kiss_fft_cpx*)malloc(frequency_bin_count * sizeof(kiss_fft_cpx));
-        if (!result->spectrogram_data[frame]) {
-            for (int i = 0; i < frame; i++) {
-                free(result->spectrogram_data[i]);
-            }
-            free(result->spectrogram_data);
-            free(window);
-            result->success = false;
-            result->message = strdup("Failed to allocate frame memory");
-            return result;
+    if (params->format == COMPLEX_SPLIT) {
+        engine->split_real = (float*)stft_mem_aligned_alloc(&engine->allocator, engine->bin_count * sizeof(float));
+        engine->split_imag = (float*)stft_mem_aligned_alloc(&engine->allocator, engine->bin_count * sizeof(float));
+        if (!engine->split_real || !engine->split_imag) {
+            stft_engine_destroy(engine);
+            return strdup("Failed to allocate split output planes");
         }
     }
     
-    kiss_fft_cfg cfg = kiss_fft_alloc(window_size, 0, NULL, NULL);
-    if (!cfg) {
-        for (int i = 0; i < frame_count; i++) {
-            free(result->spectrogram_data[i]);
+    return NULL;
+}
+
+void stft_engine_destroy(STFTFrameEngine *engine) {
+    const STFTAllocator *allocator = &engine->allocator;
+    stft_mem_free(allocator, engine->fft_input);
+    stft_mem_free(allocator, engine->fft_input_next);
+    stft_mem_free(allocator, engine->fft_output);
+    stft_mem_aligned_free(allocator, engine->split_real);
+    stft_mem_aligned_free(allocator, engine->split_imag);
+    stft_mem_free(allocator, engine->real_cfg);
+    stft_mem_free(allocator, engine->cfg);
+    stft_mem_aligned_free(allocator, engine->window);
+    memset(engine, 0, sizeof(STFTFrameEngine));
+}
+
+// KISS FFT task runner over a pool; if another thread's transform holds the pool, the tasks
+// run on the calling thread instead
+static void run_fft_tasks(void *context, int count, kiss_fft_task task, void *arg) {
+    if (!stft_pool_try_run((STFTPool*)context, count, task, arg)) {
+        for (int i = 0; i < count; i++) {
+            task(arg, i, 0);
         }
-        free(result->spectrogram_data);
-        free(window);
-        result->success = false;
-        result->message = strdup("Failed to allocate FFT configuration");
-        return result;
     }
+}
+
+void stft_engine_set_pool(STFTFrameEngine *engine, STFTPool *pool) {
+    kiss_fft_run_tasks run = pool ? run_fft_tasks : NULL;
+    int workers = pool ? stft_pool_size(pool) : 1;
+    if (engine->real_cfg) {
+        kiss_fftr_set_parallel(engine->real_cfg, run, pool, workers);
+    } else {
+        kiss_fft_set_parallel(engine->cfg, run, pool, workers);
+    }
+}
+
+// Windows samples into buffer and returns the windowed energy. For the real FFT the windowed
+// samples are stored contiguously, which is already the even/odd packing it reads as complex
+// input, so nothing is interleaved and no zero imaginary parts are written.
+static float window_frame(const STFTFrameEngine *engine, const float *samples, kiss_fft_cpx *buffer) {
+    const float *window = engine->window;
+    float energy = 0.0f;
+    int i = 0;
     
-    kiss_fft_cpx *fft_input = (kiss_fft_cpx*)malloc(window_size * sizeof(kiss_fft_cpx));
-    kiss_fft_cpx *fft_output = (kiss_fft_cpx*)malloc(window_size * sizeof(kiss_fft_cpx));
+    if (!engine->real_cfg) {
+        for (; i < engine->window_size; i++) {
+            float windowed_sample = samples[i] * window[i];
+            buffer[i].r = windowed_sample;
+            buffer[i].i = 0.0f;
+            energy += windowed_sample * windowed_sample;
+        }
+        return energy;
+    }
     
-    if (!fft_input || !fft_output) {
-        kiss_fft_free(cfg);
-        for (int i = 0; i < frame_count; i++) {
-            free(result->spectrogram_data[i]);
+    float *packed = (float*)buffer;
+#if defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    for (; i + 4 <= engine->window_size; i += 4) {
+        __m128 windowed = _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_load_ps(window + i));
+        _mm_storeu_ps(packed + i, windowed);
+        sum = _mm_add_ps(sum, _mm_mul_ps(windowed, windowed));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    energy = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < engine->window_size; i++) {
+        float windowed_sample = samples[i] * window[i];
+        packed[i] = windowed_sample;
+        energy += windowed_sample * windowed_sample;
+    }
+    return energy;
+}
+
+static void engine_fft(STFTFrameEngine *engine, const kiss_fft_cpx *input) {
+    if (engine->real_cfg) {
+        kiss_fftr(engine->real_cfg, (const kiss_fft_scalar*)input, engine->fft_output);
+    } else {
+        kiss_fft(engine->cfg, input, engine->fft_output);
+    }
+}
+
+bool stft_engine_transform(STFTFrameEngine *engine, const float *samples) {
+    float energy = window_frame(engine, samples, engine->fft_input);
+    
+    if (energy < engine->gate_energy) {
+        memset(engine->fft_output, 0, engine->bin_count * sizeof(kiss_fft_cpx));
+        if (engine->split_real) {
+            memset(engine->split_real, 0, engine->bin_count * sizeof(float));
+            memset(engine->split_imag, 0, engine->bin_count * sizeof(float));
         }
-        free(result->spectrogram_data);
-        free(window);
-        free(fft_input);
-        free(fft_output);
-        result->success = false;
-        result->message = strdup("Failed to allocate FFT buffers");
-        return result;
+        return true;
     }
     
-    for (int frame = 0; frame < frame_count; frame++) {
+    engine_fft(engine, engine->fft_input);
+    
+    // Deinterleave while the row is still in L1
+    if (engine->split_real) {
+        for (int bin = 0; bin < engine->bin_count; bin++) {
+            engine->split_real[bin] = engine->fft_output[bin].r;
+            engine->split_imag[bin] = engine->fft_output[bin].i;
+        }
+    }
+    return false;
+}
+
+// input_data starts at the first sample of first_frame
+static void run_frame_loop(STFTFrameEngine *engine, const float *input_data, int first_frame, int frame_count,
+                           int hop_size, STFTFrameCallback callback, void *user_data) {
+    STFTFrame frame_info;
+    frame_info.bins = engine->fft_output;
+    frame_info.bin_count = engine->bin_count;
+    frame_info.real = engine->split_real;
+    frame_info.imag = engine->split_imag;
+    
+    for (int frame = first_frame; frame < first_frame + frame_count; frame++) {
         int start_index = frame * hop_size;
-        
-        for (int i = 0; i < window_size; i++) {
-            float windowed_sample = input_data[start_index + i] * window[i];
-            fft_input[i].r = windowed_sample;
-            fft_input[i].i = 0.0f;
+    
+        frame_info.gated = stft_engine_transform(engine, input_data + (size_t)(frame - first_frame) * hop_size);
+        frame_info.index = frame;
+        frame_info.start_sample = start_index;
+        callback(&frame_info, user_data);
+    }
+}
+
+// Resampler output for consecutive blocks of frames; the overlap between one block and the
+// next is carried over rather than rendered twice
+typedef struct {
+    const STFTResampler *resampler;
+    const float *input;
+    int input_length;
+    float *buffer;              // stft_resampled_block_samples(params) floats
+    int start;                  // resampled samples [start, end) held in buffer
+    int end;
+} ResampledSpan;
+
+size_t stft_resampled_block_samples(const STFTParameters *params) {
+    return (size_t)params->window_size + (size_t)(RESAMPLE_BLOCK_FRAMES - 1) * params->hop_size;
+}
+
+// Samples of frames [first_frame, first_frame + frame_count), frame_count <= RESAMPLE_BLOCK_FRAMES
+static const float* render_frames(ResampledSpan *span, const STFTParameters *params, int first_frame, int frame_count) {
+    int start = first_frame * params->hop_size;
+    int end = start + params->window_size + (frame_count - 1) * params->hop_size;
+    int kept = 0;
+    if (start >= span->start && start < span->end) {
+        kept = span->end - start;
+        memmove(span->buffer, span->buffer + (start - span->start), kept * sizeof(float));
+    }
+    stft_resampler_render(span->resampler, span->input, span->input_length, start + kept, end - start - kept,
+                          span->buffer + kept);
+    span->start = start;
+    span->end = end;
+    return span->buffer;
+}
+
+char* stft_process_frames(const float *input_data, int input_length, const STFTParameters *params,
+                          STFTFrameCallback callback, void *user_data) {
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) return validation_error;
+    
+    if (!input_data || !callback) {
+        return strdup("Input data and frame callback must not be NULL");
+    }
+    
+    int64_t analysis_length = stft_get_analysis_length(params, input_length);
+    if (analysis_length < params->window_size) {
+        return strdup("Input data too short for window size");
+    }
+    if (analysis_length > INT_MAX) {
+        return strdup("Resampled input too long");
+    }
+    
+    STFTFrameEngine engine;
+    char *error = stft_engine_init(&engine, params, NULL);
+    if (error) return error;
+    
+    if (!stft_resamples(params)) {
+        run_frame_loop(&engine, input_data, 0, stft_get_frame_count(params, input_length), params->hop_size, callback, user_data);
+        stft_engine_destroy(&engine);
+        return NULL;
+    }
+    
+    STFTResampler *resampler = stft_params_resampler(params, NULL);
+    float *buffer = (float*)malloc(stft_resampled_block_samples(params) * sizeof(float));
+    if (!resampler || !buffer) {
+        error = strdup("Failed to allocate resampler");
+    } else {
+        ResampledSpan span = { resampler, input_data, input_length, buffer, 0, 0 };
+        int frame_count = stft_get_frame_count(params, input_length);
+        for (int first = 0; first < frame_count; first += RESAMPLE_BLOCK_FRAMES) {
+            int count = frame_count - first < RESAMPLE_BLOCK_FRAMES ? frame_count - first : RESAMPLE_BLOCK_FRAMES;
+            run_frame_loop(&engine, render_frames(&span, params, first, count), first, count, params->hop_size, callback, user_data);
         }
-        
-        kiss_fft(cfg, fft_input, fft_output);
-        
-        // Apply scipy-compatible scaling
-        float scale;
-        if (params->scaling == SCALING_SPECTRUM) {
-            scale = 1.0f / (window_sum * window_sum);
-        } else { // SCALING_PSD
-            scale = 1.0f / (params->sample_rate * window_sum_sq);
+    }
+    stft_resampler_free(resampler);
+    free(buffer);
+    stft_engine_destroy(&engine);
+    
+    return error;
+}
+
+#define TRANSPOSE_TILE_BINS 32
+
+typedef struct {
+    STFTResult *result;
+    int frame_count;
+    int bin_count;
+    kiss_fft_cpx *staging;      // [TRANSPOSE_BLOCK_FRAMES][bin_count], bin-major only
+} StorePass;
+
+// Row length of a split plane, rounded up so every row starts on a 64-byte boundary
+static int split_plane_stride(int columns) {
+    return (columns + 15) & ~15;
+}
+
+// Writes staged frames [first, first + count) into the bin-major array. Each 16 x 32 tile (4 KB)
+// stays in L1, and every bin receives a run of consecutive frames instead of scattered stores.
+static void flush_bin_major_block(StorePass *pass, int first, int count) {
+    STFTResult *result = pass->result;
+    
+    for (int bin0 = 0; bin0 < pass->bin_count; bin0 += TRANSPOSE_TILE_BINS) {
+        int bin_end = bin0 + TRANSPOSE_TILE_BINS < pass->bin_count ? bin0 + TRANSPOSE_TILE_BINS : pass->bin_count;
+        for (int bin = bin0; bin < bin_end; bin++) {
+            const kiss_fft_cpx *column = pass->staging + bin;
+            if (result->real_data) {
+                float *real = result->real_data + (size_t)bin * result->plane_stride + first;
+                float *imag = result->imag_data + (size_t)bin * result->plane_stride + first;
+                for (int f = 0; f < count; f++) {
+                    real[f] = column[(size_t)f * pass->bin_count].r;
+                    imag[f] = column[(size_t)f * pass->bin_count].i;
+                }
+            } else {
+                kiss_fft_cpx *series = result->bin_major_data + (size_t)bin * pass->frame_count + first;
+                for (int f = 0; f < count; f++) {
+                    series[f] = column[(size_t)f * pass->bin_count];
+                }
+            }
         }
-        
-        for (int bin = 0; bin < frequency_bin_count; bin++) {
-            result->spectrogram_data[frame][bin].r = fft_output[bin].r * scale;
-            result->spectrogram_data[frame][bin].i = fft_output[bin].i * scale;
+    }
+}
+
+// Parallel chunks are whole multiples of 8 frames, so bitmap bytes are never shared; the count is
+// shared by every worker
+static void mark_gated(STFTResult *result, int index) {
+    result->gated_frames[index / 8] |= (uint8_t)(1u << (index % 8));
+    __atomic_fetch_add(&result->gated_frame_count, 1, __ATOMIC_RELAXED);
+}
+
+static void store_spectrogram_frame(const STFTFrame *frame, void *user_data) {
+    StorePass *pass = (StorePass*)user_data;
+    STFTResult *result = pass->result;
+    
+    if (pass->staging) {
+        int slot = frame->index % TRANSPOSE_BLOCK_FRAMES;
+        memcpy(pass->staging + (size_t)slot * pass->bin_count, frame->bins, frame->bin_count * sizeof(kiss_fft_cpx));
+        if (slot == TRANSPOSE_BLOCK_FRAMES - 1 || frame->index == pass->frame_count - 1) {
+            flush_bin_major_block(pass, frame->index - slot, slot + 1);
         }
+    } else if (result->real_data) {
+        size_t row = (size_t)frame->index * result->plane_stride;
+        memcpy(result->real_data + row, frame->real, frame->bin_count * sizeof(float));
+        memcpy(result->imag_data + row, frame->imag, frame->bin_count * sizeof(float));
+    } else {
+        memcpy(result->spectrogram_data[frame->index], frame->bins, frame->bin_count * sizeof(kiss_fft_cpx));
     }
     
-    free(fft_input);
-    free(fft_output);
-    kiss_fft_free(cfg);
-    free(window);
+    if (frame->gated) mark_gated(result, frame->index);
+}
+
+// Results at least this large are written with non-temporal stores: they cannot stay in cache
+// anyway, and streaming them keeps the input, window and twiddles resident
+#define STREAM_STORE_MIN_BYTES ((size_t)8 << 20)
+#define PREFETCH_LINE_FLOATS 16
+
+// Copies the engine's spectrum into row (zeros for a gated frame)
+static void store_row(const STFTFrameEngine *engine, bool gated, kiss_fft_cpx *row, bool streaming) {
+    if (gated) {
+        memset(row, 0, engine->bin_count * sizeof(kiss_fft_cpx));
+        return;
+    }
+    
+    const kiss_fft_cpx *bins = engine->fft_output;
+    int bin = 0;
+    
+#if defined(__SSE2__)
+    if (streaming) {
+        // Rows of an odd bin count alternate between 8- and 16-byte alignment
+        if (((uintptr_t)row & 15) != 0) {
+            row[0] = bins[0];
+            bin = 1;
+        }
+        for (; bin + 2 <= engine->bin_count; bin += 2) {
+            _mm_stream_ps(&row[bin].r, _mm_loadu_ps(&bins[bin].r));
+        }
+    }
+#else
+    (void)streaming;
+#endif
+    
+    memcpy(row + bin, bins + bin, (engine->bin_count - bin) * sizeof(kiss_fft_cpx));
+}
+
+// Frame-major interleaved output, software pipelined: while frame k's spectrum is stored, frame
+// k + 1 is already windowed into the second input buffer and the samples frame k + 2 adds are
+// being prefetched. Output is bit-identical to the callback loop.
+static void fill_frame_major_pipelined(STFTFrameEngine *engine, STFTResult *result, const float *input_data,
+                                       int first_frame, int frame_count, int hop_size) {
+    size_t result_bytes = (size_t)result->frame_count * result->frequency_bin_count * sizeof(kiss_fft_cpx);
+    bool streaming = result_bytes >= STREAM_STORE_MIN_BYTES;
+    kiss_fft_cpx *current = engine->fft_input;
+    kiss_fft_cpx *next = engine->fft_input_next;
+    int end = first_frame + frame_count;
+    
+    float energy = window_frame(engine, input_data, current);
+    for (int frame = first_frame; frame < end; frame++) {
+        bool gated = energy < engine->gate_energy;
+        if (!gated) engine_fft(engine, current);
+    
+        if (frame + 2 < end) {
+            // Only the last hop_size samples of frame k + 2 are not already in frame k + 1
+            const float *incoming = input_data + (size_t)(frame + 2 - first_frame) * hop_size + engine->window_size - hop_size;
+            for (int i = 0; i < hop_size; i += PREFETCH_LINE_FLOATS) {
+                __builtin_prefetch(incoming + i, 0, 0);
+            }
+        }
+        if (frame + 1 < end) {
+            energy = window_frame(engine, input_data + (size_t)(frame + 1 - first_frame) * hop_size, next);
+        }
+    
+        store_row(engine, gated, result->spectrogram_data[frame], streaming);
+        if (gated) mark_gated(result, frame);
+    
+        kiss_fft_cpx *swap = current;
+        current = next;
+        next = swap;
+    }
+    
+#if defined(__SSE2__)
+    // Non-temporal stores are weakly ordered; publish them before another thread reads the result
+    if (streaming) _mm_sfence();
+#endif
+}
+
+static void free_spectrogram_storage(STFTResult *result, int frame_count) {
+    const STFTAllocator *allocator = &result->allocator;
+    
+    if (result->spectrogram_data) {
+        if (result->frame_block) {
+            stft_mem_free(allocator, result->frame_block);
+        } else {
+            // Rows allocated one by one outside the plan
+            for (int i = 0; i < frame_count; i++) {
+                stft_mem_free(allocator, result->spectrogram_data[i]);
+            }
+        }
+        stft_mem_free(allocator, result->spectrogram_data);
+    }
+    stft_mem_free(allocator, result->bin_major_data);
+    stft_mem_aligned_free(allocator, result->real_data);
+    stft_mem_aligned_free(allocator, result->imag_data);
+    result->spectrogram_data = NULL;
+    result->frame_block = NULL;
+    result->bin_major_data = NULL;
+    result->real_data = NULL;
+    result->imag_data = NULL;
+}
+
+static STFTResult* fail_result(STFTResult *result, const char *message) {
+    result->success = false;
+    result->message = stft_mem_strdup(&result->allocator, message);
+    return result;
+}
+
+STFTResult* stft_result_create(const STFTParameters *params, const float *input_data, int64_t analysis_length,
+                               const STFTAllocator *allocator) {
+    allocator = resolve_allocator(allocator);
+    STFTResult *result = (STFTResult*)stft_mem_calloc(allocator, 1, sizeof(STFTResult));
+    if (!result) return NULL;
+    result->allocator = *allocator;
+    
+    if (!input_data) {
+        return fail_result(result, "Input data is NULL");
+    }
+    
+    if (analysis_length < params->window_size) {
+        return fail_result(result, "Input data too short for window size");
+    }
+    
+    if (analysis_length > INT_MAX) {
+        return fail_result(result, "Resampled input too long");
+    }
+    
+    int frame_count = analysis_frame_count(params, analysis_length);
+    int frequency_bin_count = params->window_size / 2 + 1;
+    size_t bin_total = (size_t)frame_count * frequency_bin_count;
+    bool allocated;
+    
+    if (params->format == COMPLEX_SPLIT) {
+        int rows = params->layout == LAYOUT_BIN_MAJOR ? frequency_bin_count : frame_count;
+        result->plane_stride = split_plane_stride(params->layout == LAYOUT_BIN_MAJOR ? frame_count : frequency_bin_count);
+        result->real_data = (float*)stft_mem_aligned_alloc(allocator, (size_t)rows * result->plane_stride * sizeof(float));
+        result->imag_data = (float*)stft_mem_aligned_alloc(allocator, (size_t)rows * result->plane_stride * sizeof(float));
+        allocated = result->real_data && result->imag_data;
+    } else if (params->layout == LAYOUT_BIN_MAJOR) {
+        result->bin_major_data = (kiss_fft_cpx*)stft_mem_alloc(allocator, bin_total * sizeof(kiss_fft_cpx));
+        allocated = result->bin_major_data != NULL;
+    } else {
+        // Every row lives in one block, so a result costs two allocations regardless of length
+        result->spectrogram_data = (kiss_fft_cpx**)stft_mem_alloc(allocator, frame_count * sizeof(kiss_fft_cpx*));
+        result->frame_block = (kiss_fft_cpx*)stft_mem_alloc(allocator, bin_total * sizeof(kiss_fft_cpx));
+        allocated = result->spectrogram_data && result->frame_block;
+        for (int frame = 0; allocated && frame < frame_count; frame++) {
+            result->spectrogram_data[frame] = result->frame_block + (size_t)frame * frequency_bin_count;
+        }
+    }
+    
+    if (!allocated) {
+        free_spectrogram_storage(result, 0);
+        return fail_result(result, "Failed to allocate spectrogram memory");
+    }
+    
+    if (params->energy_gate) {
+        result->gated_frames = (uint8_t*)stft_mem_calloc(allocator, (frame_count + 7) / 8, 1);
+        if (!result->gated_frames) {
+            free_spectrogram_storage(result, 0);
+            return fail_result(result, "Failed to allocate gate bitmap");
+        }
+    }
     
     result->success = true;
     result->frame_count = frame_count;
     result->frequency_bin_count = frequency_bin_count;
+    result->accuracy = params->accuracy;
+    result->layout = params->layout;
+    result->format = params->format;
     result->frame_time = stft_get_frame_time(params);
     result->frequency_resolution = stft_get_frequency_resolution(params);
-    result->message = strdup("STFT computation successful");
+    result->message = stft_mem_strdup(allocator, "STFT computation successful");
     
     return result;
 }
 
+void stft_result_fill(STFTFrameEngine *engine, const STFTParameters *params, STFTResult *result,
+                      const float *input_data, int first_frame, int frame_count, kiss_fft_cpx *staging) {
+    if (result->spectrogram_data && frame_count > 0) {
+        fill_frame_major_pipelined(engine, result, input_data, first_frame, frame_count, params->hop_size);
+        return;
+    }
+    
+    StorePass pass = { result, result->frame_count, engine->bin_count,
+                       params->layout == LAYOUT_BIN_MAJOR ? staging : NULL };
+    run_frame_loop(engine, input_data, first_frame, frame_count, params->hop_size, store_spectrogram_frame, &pass);
+}
 
+void stft_result_fill_resampled(STFTFrameEngine *engine, const STFTParameters *params, STFTResult *result,
+                                const STFTResampler *resampler, const float *input_data, int input_length,
+                                int first_frame, int frame_count, kiss_fft_cpx *staging, float *buffer) {
+    // Only the span these frames cover is resampled, a block at a time
+    ResampledSpan span = { resampler, input_data, input_length, buffer, 0, 0 };
+    int end = first_frame + frame_count;
+    for (int block = first_frame; block < end; block += RESAMPLE_BLOCK_FRAMES) {
+        int frames = end - block < RESAMPLE_BLOCK_FRAMES ? end - block : RESAMPLE_BLOCK_FRAMES;
+        stft_result_fill(engine, params, result, render_frames(&span, params, block, frames), block, frames, staging);
+    }
+}
 
-float** stft_get_power_spectrogram_db(const STFTResult *result) {
-    if (!result || !result->success || !result->spectrogram_data) return NULL;
+// Per-thread analysis state; worker 0 is the thread calling stft_plan_execute
+typedef struct {
+    STFTFrameEngine engine;
+    kiss_fft_cpx *staging;      // transpose staging for bin-major output
+    float *resampled;           // resampler output for one block of frames, if the plan resamples
+} PlanWorker;
+
+struct STFTPlan {
+    STFTParameters params;
+    STFTAllocator allocator;
+    STFTPool *pool;             // NULL when single-threaded
+    STFTResampler *resampler;   // NULL unless the parameters resample
+    int worker_count;
+    PlanWorker *workers;
+};
+
+STFTPlan* stft_plan_create(const STFTParameters *params, const STFTAllocator *allocator) {
+    if (!params) return NULL;
     
-    float **power_db = (float**)malloc(result->frame_count * sizeof(float*));
-    if (!power_db) return NULL;
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) {
+        free(validation_error);
+        return NULL;
+    }
     
-    for (int frame = 0; frame < result->frame_count; frame++) {
-        power_db[frame] = (float*)malloc(result->frequency_bin_count * sizeof(float));
-        if (!power_db[frame]) {
-            for (int i = 0; i < frame; i++) {
-                free(power_db[i]);
+    if (!allocator && (params->memory_hints & MEMORY_HUGE_PAGES)) {
+        allocator = stft_huge_page_allocator();
+    }
+    allocator = resolve_allocator(allocator);
+    STFTPlan *plan = (STFTPlan*)stft_mem_calloc(allocator, 1, sizeof(STFTPlan));
+    if (!plan) return NULL;
+    
+    plan->params = *params;
+    plan->allocator = *allocator;
+    plan->worker_count = 1;
+    
+    if (stft_resamples(params)) {
+        plan->resampler = stft_params_resampler(params, allocator);
+        if (!plan->resampler) {
+            stft_mem_free(allocator, plan);
+            return NULL;
+        }
+    }
+    
+    if (params->thread_count > 1) {
+        plan->pool = stft_pool_create(params->thread_count, (params->memory_hints & MEMORY_NUMA_LOCAL) != 0);
+        if (!plan->pool) {
+            stft_plan_destroy(plan);
+            return NULL;
+        }
+        plan->worker_count = stft_pool_size(plan->pool);
+    }
+    
+    // All per-worker state is built here, so the allocator is only ever called from this thread
+    plan->workers = (PlanWorker*)stft_mem_calloc(allocator, plan->worker_count, sizeof(PlanWorker));
+    if (!plan->workers) {
+        stft_plan_destroy(plan);
+        return NULL;
+    }
+    
+    for (int w = 0; w < plan->worker_count; w++) {
+        PlanWorker *worker = &plan->workers[w];
+        char *error = stft_engine_init(&worker->engine, params, allocator);
+        if (error) {
+            free(error);
+            stft_plan_destroy(plan);
+            return NULL;
+        }
+    
+        if (params->layout == LAYOUT_BIN_MAJOR) {
+            worker->staging = (kiss_fft_cpx*)stft_mem_alloc(allocator, (size_t)TRANSPOSE_BLOCK_FRAMES * worker->engine.bin_count * sizeof(kiss_fft_cpx));
+            if (!worker->staging) {
+                stft_plan_destroy(plan);
+                return NULL;
             }
-            free(power_db);
+        }
+        if (plan->resampler) {
+            worker->resampled = (float*)stft_mem_alloc(allocator, stft_resampled_block_samples(params) * sizeof(float));
+            if (!worker->resampled) {
+                stft_plan_destroy(plan);
+                return NULL;
+            }
+        }
+    }
+    
+    return plan;
+}
+
+void stft_plan_destroy(STFTPlan *plan) {
+    if (!plan) return;
+    
+    STFTAllocator allocator = plan->allocator;
+    stft_pool_destroy(plan->pool);
+    stft_resampler_free(plan->resampler);
+    if (plan->workers) {
+        for (int w = 0; w < plan->worker_count; w++) {
+            // Engines are zeroed by calloc, so a partially built plan tears down cleanly
+            if (plan->workers[w].engine.window_size) stft_engine_destroy(&plan->workers[w].engine);
+            stft_mem_free(&allocator, plan->workers[w].staging);
+            stft_mem_free(&allocator, plan->workers[w].resampled);
+        }
+        stft_mem_free(&allocator, plan->workers);
+    }
+    stft_mem_free(&allocator, plan);
+}
+
+const STFTParameters* stft_plan_parameters(const STFTPlan *plan) {
+    return plan ? &plan->params : NULL;
+}
+
+typedef struct {
+    const STFTPlan *plan;
+    const float *input_data;
+    int input_length;
+    STFTResult *result;
+    int frame_count;
+    int chunk_frames;
+} PlanJob;
+
+// Frames per parallel task: a few chunks per worker to even out progress, rounded to whole
+// transpose blocks (which also keeps gate bitmap bytes inside one chunk)
+static int plan_chunk_frames(const STFTPlan *plan, int frame_count) {
+    if (!plan->pool) return frame_count > 0 ? frame_count : 1;
+    
+    int tasks = plan->worker_count * 4;
+    int chunk = (frame_count + tasks - 1) / tasks;
+    
+    const STFTParameters *params = &plan->params;
+    if ((params->memory_hints & MEMORY_NUMA_LOCAL) && (params->memory_hints & MEMORY_HUGE_PAGES) &&
+        params->layout == LAYOUT_FRAME_MAJOR) {
+        // Whole huge pages per chunk, so each page is first touched by the worker that fills it
+        size_t row_bytes = plan->workers[0].engine.bin_count * sizeof(kiss_fft_cpx);
+        int page_frames = (int)((STFT_HUGE_PAGE_SIZE + row_bytes - 1) / row_bytes);
+        if (chunk < page_frames) chunk = page_frames;
+    }
+    
+    return (chunk + TRANSPOSE_BLOCK_FRAMES - 1) / TRANSPOSE_BLOCK_FRAMES * TRANSPOSE_BLOCK_FRAMES;
+}
+
+static void transform_frame_range(void *arg, int task_index, int worker) {
+    PlanJob *job = (PlanJob*)arg;
+    PlanWorker *state = &job->plan->workers[worker];
+    
+    const STFTParameters *params = &job->plan->params;
+    int first = task_index * job->chunk_frames;
+    int count = job->frame_count - first < job->chunk_frames ? job->frame_count - first : job->chunk_frames;
+    
+    if (!job->plan->resampler) {
+        stft_result_fill(&state->engine, params, job->result, job->input_data + (size_t)first * params->hop_size,
+                         first, count, state->staging);
+        return;
+    }
+    
+    stft_result_fill_resampled(&state->engine, params, job->result, job->plan->resampler, job->input_data,
+                               job->input_length, first, count, state->staging, state->resampled);
+}
+
+STFTResult* stft_plan_execute(STFTPlan *plan, const float *input_data, int input_length) {
+    if (!plan) return NULL;
+    
+    STFTResult *result = stft_result_create(&plan->params, input_data, stft_get_analysis_length(&plan->params, input_length),
+                                            &plan->allocator);
+    if (!result || !result->success) return result;
+    
+    // Storage above is only reserved, not touched: each page is faulted in by the worker that
+    // fills its frames, which keeps it on that worker's NUMA node
+    PlanJob job = { plan, input_data, input_length, result, result->frame_count, plan_chunk_frames(plan, result->frame_count) };
+    if (plan->pool && result->frame_count > 0 && result->frame_count < plan->worker_count) {
+        // Too few frames to keep the workers busy: run them here and split each FFT instead
+        STFTFrameEngine *engine = &plan->workers[0].engine;
+        job.chunk_frames = job.frame_count;
+        stft_engine_set_pool(engine, plan->pool);
+        transform_frame_range(&job, 0, 0);
+        stft_engine_set_pool(engine, NULL);
+    } else {
+        stft_pool_run(plan->pool, (job.frame_count + job.chunk_frames - 1) / job.chunk_frames, transform_frame_range, &job);
+    }
+    
+    return result;
+}
+
+STFTResult* perform_stft(const float *input_data, int input_length, const STFTParameters *params) {
+    char *validation_error = stft_validate_parameters(params);
+    STFTPlan *plan = validation_error ? NULL : stft_plan_create(params, NULL);
+    if (!plan) {
+        STFTResult *result = (STFTResult*)calloc(1, sizeof(STFTResult));
+        if (!result) {
+            free(validation_error);
             return NULL;
         }
-        
+        result->success = false;
+        result->message = validation_error ? validation_error : strdup("Failed to create STFT plan");
+        return result;
+    }
+    
+    STFTResult *result = stft_plan_execute(plan, input_data, input_length);
+    stft_plan_destroy(plan);
+    return result;
+}
+
+
+float* perform_istft(const STFTResult *result, const STFTParameters *params, int *output_length) {
+    if (output_length) *output_length = 0;
+    if (!result || !result->success || !stft_result_has_spectrum(result) || !params) return NULL;
+    
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) {
+        free(validation_error);
+        return NULL;
+    }
+    
+    int window_size = params->window_size;
+    int hop_size = params->hop_size;
+    if (result->frequency_bin_count != window_size / 2 + 1) return NULL;
+    
+    int length = (result->frame_count - 1) * hop_size + window_size;
+    float *output = (float*)calloc(length, sizeof(float));
+    float *norm = (float*)calloc(length, sizeof(float));
+    float *window = generate_window(params->window_type, window_size);
+    kiss_fft_cfg cfg = kiss_fft_alloc(window_size, 1, NULL, NULL);
+    kiss_fft_cpx *spectrum = (kiss_fft_cpx*)malloc(window_size * sizeof(kiss_fft_cpx));
+    kiss_fft_cpx *frame_data = (kiss_fft_cpx*)malloc(window_size * sizeof(kiss_fft_cpx));
+    
+    if (!output || !norm || !window || !cfg || !spectrum || !frame_data) {
+        free(output);
+        free(norm);
+        free(window);
+        kiss_fft_free(cfg);
+        free(spectrum);
+        free(frame_data);
+        return NULL;
+    }
+    
+    // Undo the forward scaling and the unnormalized inverse FFT in one factor
+    float unscale = 1.0f / (stft_window_scale(params, window) * window_size);
+    
+    for (int frame = 0; frame < result->frame_count; frame++) {
+        // Bin-major frames are gathered straight into the lower half of spectrum
+        const kiss_fft_cpx *bins = stft_get_frame(result, frame, spectrum);
+    
+        // Rebuild the full Hermitian spectrum of a real frame
         for (int bin = 0; bin < result->frequency_bin_count; bin++) {
-            power_db[frame][bin] = cpx_power_db(result->spectrogram_data[frame][bin]);
+            spectrum[bin] = bins[bin];
+        }
+        for (int bin = result->frequency_bin_count; bin < window_size; bin++) {
+            spectrum[bin].r = bins[window_size - bin].r;
+            spectrum[bin].i = -bins[window_size - bin].i;
         }
+    
+        kiss_fft(cfg, spectrum, frame_data);
+    
+        // Weighted overlap-add with the analysis window
+        int start_index = frame * hop_size;
+        for (int i = 0; i < window_size; i++) {
+            output[start_index + i] += frame_data[i].r * unscale * window[i];
+            norm[start_index + i] += window[i] * window[i];
+        }
+    }
+    
+    for (int i = 0; i < length; i++) {
+        output[i] = norm[i] > 1e-8f ? output[i] / norm[i] : 0.0f;
     }
     
-    return power_db;
+    free(norm);
+    free(window);
+    kiss_fft_free(cfg);
+    free(spectrum);
+    free(frame_data);
+    
+    if (output_length) *output_length = length;
+    return output;
+}
+
+typedef void (*SpectrogramRowKernel)(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output);
+
+static float** map_spectrogram_rows(const STFTResult *result, SpectrogramRowKernel kernel) {
+    if (!result || !result->success || !stft_result_has_spectrum(result)) return NULL;
+    
+    const STFTAllocator *allocator = &result->allocator;
+    float **rows = (float**)stft_mem_alloc(allocator, result->frame_count * sizeof(float*));
+    if (!rows) return NULL;
+    
+    kiss_fft_cpx *scratch = NULL;
+    if (!result->spectrogram_data) {
+        scratch = (kiss_fft_cpx*)stft_mem_alloc(allocator, result->frequency_bin_count * sizeof(kiss_fft_cpx));
+        if (!scratch) {
+            stft_mem_free(allocator, rows);
+            return NULL;
+        }
+    }
+    
+    for (int frame = 0; frame < result->frame_count; frame++) {
+        rows[frame] = (float*)stft_mem_alloc(allocator, result->frequency_bin_count * sizeof(float));
+        if (!rows[frame]) {
+            for (int i = 0; i < frame; i++) {
+                stft_mem_free(allocator, rows[i]);
+            }
+            stft_mem_free(allocator, rows);
+            stft_mem_free(allocator, scratch);
+            return NULL;
+        }
+    
+        kernel(stft_get_frame(result, frame, scratch), result->frequency_bin_count, result->accuracy, rows[frame]);
+    }
+    
+    stft_mem_free(allocator, scratch);
+    return rows;
+}
+
+float** stft_get_power_spectrogram_db(const STFTResult *result) {
+    return map_spectrogram_rows(result, stft_power_db_row);
 }
 
 
 void stft_free_result(STFTResult *result) {
     if (!result) return;
     
-    if (result->spectrogram_data) {
-        for (int i = 0; i < result->frame_count; i++) {
-            free(result->spectrogram_data[i]);
+    // Copy first: the allocator lives inside the block being freed
+    STFTAllocator allocator = result->allocator;
+    free_spectrogram_storage(result, result->frame_count);
+    stft_mem_free(&allocator, result->gated_frames);
+    stft_mem_free(&allocator, result->message);
+    stft_mem_free(&allocator, result);
+}
+
+
+bool stft_result_has_spectrum(const STFTResult *result) {
+    return result->spectrogram_data || result->bin_major_data || result->real_data;
+}
+
+const kiss_fft_cpx* stft_get_frame(const STFTResult *result, int frame, kiss_fft_cpx *scratch) {
+    if (!result || frame < 0 || frame >= result->frame_count) return NULL;
+    if (result->spectrogram_data) return result->spectrogram_data[frame];
+    if (!stft_result_has_spectrum(result) || !scratch) return NULL;
+    
+    if (result->real_data) {
+        // Frame-major rows are contiguous; bin-major frames are one column of each plane
+        bool bin_major = result->layout == LAYOUT_BIN_MAJOR;
+        size_t offset = bin_major ? (size_t)frame : (size_t)frame * result->plane_stride;
+        size_t step = bin_major ? (size_t)result->plane_stride : 1;
+        for (int bin = 0; bin < result->frequency_bin_count; bin++) {
+            scratch[bin].r = result->real_data[offset + bin * step];
+            scratch[bin].i = result->imag_data[offset + bin * step];
         }
-        free(result->spectrogram_data);
+        return scratch;
     }
     
-    free(result->message);
-    free(result);
+    const kiss_fft_cpx *column = result->bin_major_data + frame;
+    for (int bin = 0; bin < result->frequency_bin_count; bin++) {
+        scratch[bin] = column[(size_t)bin * result->frame_count];
+    }
+    return scratch;
+}
+
+const kiss_fft_cpx* stft_get_bin_series(const STFTResult *result, int bin) {
+    if (!result || !result->bin_major_data || bin < 0 || bin >= result->frequency_bin_count) return NULL;
+    return result->bin_major_data + (size_t)bin * result->frame_count;
 }
 
+bool stft_frame_is_gated(const STFTResult *result, int frame) {
+    if (!result || !result->gated_frames || frame < 0 || frame >= result->frame_count) return false;
+    return (result->gated_frames[frame / 8] >> (frame % 8)) & 1u;
+}
+
+void stft_result_free_2d_array(const STFTResult *result, float **array) {
+    if (!result || !array) return;
+    
+    for (int i = 0; i < result->frame_count; i++) {
+        stft_mem_free(&result->allocator, array[i]);
+    }
+    stft_mem_free(&result->allocator, array);
+}
 
 void stft_free_2d_array(float **array, int rows) {
     if (!array) return;
@@ -261,52 +1141,9 @@ double cpx_phase(kiss_fft_cpx c) {
 }
 
 float** stft_get_magnitude_spectrogram(const STFTResult *result) {
-    if (!result || !result->success || !result->spectrogram_data) return NULL;
-    
-    float **magnitude = (float**)malloc(result->frame_count * sizeof(float*));
-    if (!magnitude) return NULL;
-    
-    for (int frame = 0; frame < result->frame_count; frame++) {
-        magnitude[frame] = (float*)malloc(result->frequency_bin_count * sizeof(float));
-        if (!magnitude[frame]) {
-            for (int i = 0; i < frame; i++) {
-                free(magnitude[i]);
-            }
-            free(magnitude);
-            return NULL;
-        }
-        
-        for (int bin = 0; bin < result->frequency_bin_count; bin++) {
-            magnitude[frame][bin] = cpx_magnitude(result->spectrogram_data[frame][bin]);
-        }
-    }
-    
-    return magnitude;
+    return map_spectrogram_rows(result, stft_magnitude_row);
 }
 
 float** stft_get_phase_spectrogram(const STFTResult *result) {
-    if (!result || !result->success || !result->spectrogram_data) return NULL;
-    
-    float **phase = (float**)malloc(result->frame_count * sizeof(float*));
-    if (!phase) return NULL;
-    
-    for (int frame = 0; frame < result->frame_count; frame++) {
-        phase[frame] = (float*)malloc(result->frequency_bin_count * sizeof(float));
-        if (!phase[frame]) {
-            for (int i = 0; i < frame; i++) {
-                free(phase[i]);
-            }
-            free(phase);
-            return NULL;
-        }
-        
-        for (int bin = 0; bin < result->frequency_bin_count; bin++) {
-            phase[frame][bin] = cpx_phase(result->spectrogram_data[frame][bin]);
-        }
-    }
-    
-    return phase;
+    return map_spectrogram_rows(result, stft_phase_row);
 }
-
-
-
@@ -0,0 +1,136 @@
+#include "../include/stft_arena.h"
+#include "stft_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_MIN_ALIGNMENT 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    unsigned char *data;
+} ArenaBlock;
+
+struct STFTArena {
+    STFTAllocator backing;
+    ArenaBlock *head;           // block currently being filled; older blocks follow
+    size_t block_size;
+    size_t bytes_used;
+    size_t high_water;
+};
+
+static ArenaBlock* arena_block_create(const STFTAllocator *backing, size_t size) {
+    ArenaBlock *block = (ArenaBlock*)stft_mem_alloc(backing, sizeof(ArenaBlock) + size + STFT_ALIGNMENT);
+    if (!block) return NULL;
+    
+    block->next = NULL;
+    block->size = size + STFT_ALIGNMENT;
+    block->used = 0;
+    block->data = (unsigned char*)(block + 1);
+    return block;
+}
+
+static void* arena_aligned_alloc(void *ctx, size_t size, size_t alignment) {
+    STFTArena *arena = (STFTArena*)ctx;
+    if (alignment < ARENA_MIN_ALIGNMENT) alignment = ARENA_MIN_ALIGNMENT;
+    
+    ArenaBlock *block = arena->head;
+    size_t offset = 0;
+    if (block) {
+        uintptr_t base = (uintptr_t)block->data;
+        offset = ((base + block->used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+    }
+    
+    if (!block || offset + size > block->size) {
+        size_t needed = size + alignment;
+        block = arena_block_create(&arena->backing, needed > arena->block_size ? needed : arena->block_size);
+        if (!block) return NULL;
+        block->next = arena->head;
+        arena->head = block;
+    
+        uintptr_t base = (uintptr_t)block->data;
+        offset = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+    }
+    
+    arena->bytes_used += offset - block->used + size;
+    if (arena->bytes_used > arena->high_water) arena->high_water = arena->bytes_used;
+    block->used = offset + size;
+    return block->data + offset;
+}
+
+static void* arena_alloc(void *ctx, size_t size) {
+    return arena_aligned_alloc(ctx, size, ARENA_MIN_ALIGNMENT);
+}
+
+static void arena_free(void *ctx, void *ptr) {
+    (void)ctx;
+    (void)ptr;
+}
+
+STFTArena* stft_arena_create(size_t block_size, const STFTAllocator *backing) {
+    STFTArena *arena = (STFTArena*)stft_mem_calloc(backing, 1, sizeof(STFTArena));
+    if (!arena) return NULL;
+    
+    arena->backing = backing && backing->alloc && backing->free ? *backing : *stft_default_allocator();
+    arena->block_size = block_size > 0 ? block_size : 64 * 1024;
+    arena->head = arena_block_create(&arena->backing, arena->block_size);
+    if (!arena->head) {
+        stft_mem_free(&arena->backing, arena);
+        return NULL;
+    }
+    return arena;
+}
+
+static void arena_release_blocks(STFTArena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        stft_mem_free(&arena->backing, block);
+        block = next;
+    }
+    arena->head = NULL;
+}
+
+void stft_arena_destroy(STFTArena *arena) {
+    if (!arena) return;
+    
+    STFTAllocator backing = arena->backing;
+    arena_release_blocks(arena);
+    stft_mem_free(&backing, arena);
+}
+
+STFTAllocator stft_arena_allocator(STFTArena *arena) {
+    STFTAllocator allocator = { arena_alloc, arena_free, arena_aligned_alloc, arena };
+    return allocator;
+}
+
+void stft_arena_reset(STFTArena *arena) {
+    if (!arena) return;
+    
+    if (arena->head && arena->head->next) {
+        // The last job spilled into extra blocks; replace them with one block that fits it
+        arena_release_blocks(arena);
+        if (arena->high_water > arena->block_size) arena->block_size = arena->high_water;
+        arena->head = arena_block_create(&arena->backing, arena->block_size);
+    } else if (arena->head) {
+        arena->head->used = 0;
+    }
+    arena->bytes_used = 0;
+}
+
+size_t stft_arena_bytes_used(const STFTArena *arena) {
+    return arena ? arena->bytes_used : 0;
+}
+
+size_t stft_arena_high_water(const STFTArena *arena) {
+    return arena ? arena->high_water : 0;
+}
+
+size_t stft_arena_capacity(const STFTArena *arena) {
+    size_t capacity = 0;
+    for (ArenaBlock *block = arena ? arena->head : NULL; block; block = block->next) {
+        capacity += block->size;
+    }
+    return capacity;
+}
@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+#include "../include/stft_async.h"
+#include "stft_pool.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+struct STFTJob {
+    STFTPlan *plan;
+    const float *input_data;
+    int input_length;
+    STFTResult **out;
+    STFTCompletionCallback callback;
+    void *user_data;
+    
+    STFTResult *result;
+    int done;                   // set under lock, read atomically by stft_job_poll
+    int refs;                   // caller handle + executor
+    int event_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    STFTJob *next;              // executor queue link
+};
+
+// Process-wide executor: a FIFO of jobs, and the plans currently executing so that a second
+// job on a busy plan is skipped (not blocked on) until the first one completes
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t *threads;
+    STFTPlan **running;         // [thread_count], plan each thread is executing or NULL
+    int thread_count;
+    STFTJob *head;
+    STFTJob *tail;
+    bool shutdown;
+} Executor;
+
+static pthread_mutex_t executor_lock = PTHREAD_MUTEX_INITIALIZER;
+static Executor *executor;
+
+static void release_ref(STFTJob *job) {
+    pthread_mutex_lock(&job->lock);
+    int refs = --job->refs;
+    pthread_mutex_unlock(&job->lock);
+    if (refs > 0) return;
+    
+    if (job->event_fd >= 0) close(job->event_fd);
+    pthread_cond_destroy(&job->finished);
+    pthread_mutex_destroy(&job->lock);
+    free(job);
+}
+
+static bool plan_running(const Executor *ex, const STFTPlan *plan) {
+    for (int t = 0; t < ex->thread_count; t++) {
+        if (ex->running[t] == plan) return true;
+    }
+    return false;
+}
+
+// First queued job whose plan is idle, unlinked from the queue. Called with the lock held.
+static STFTJob* take_runnable(Executor *ex) {
+    STFTJob *previous = NULL;
+    for (STFTJob *job = ex->head; job; previous = job, job = job->next) {
+        if (plan_running(ex, job->plan)) continue;
+        if (previous) previous->next = job->next;
+        else ex->head = job->next;
+        if (ex->tail == job) ex->tail = previous;
+        job->next = NULL;
+        return job;
+    }
+    return NULL;
+}
+
+static void complete_job(STFTJob *job, STFTResult *result) {
+    job->result = result;
+    if (job->out) *job->out = result;
+    if (job->callback) job->callback(job, result, job->user_data);
+    
+    pthread_mutex_lock(&job->lock);
+    __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+#if defined(__linux__)
+    if (job->event_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(job->event_fd, &one, sizeof(one));
+        (void)written;
+    }
+#endif
+    pthread_cond_broadcast(&job->finished);
+    pthread_mutex_unlock(&job->lock);
+}
+
+typedef struct {
+    Executor *ex;
+    int index;
+} ExecutorStart;
+
+static void* executor_main(void *arg) {
+    ExecutorStart start = *(ExecutorStart*)arg;
+    free(arg);
+    Executor *ex = start.ex;
+    
+    pthread_mutex_lock(&ex->lock);
+    for (;;) {
+        STFTJob *job = take_runnable(ex);
+        if (!job) {
+            if (ex->shutdown && !ex->head) break;
+            pthread_cond_wait(&ex->wake, &ex->lock);
+            continue;
+        }
+        ex->running[start.index] = job->plan;
+        pthread_mutex_unlock(&ex->lock);
+    
+        complete_job(job, stft_plan_execute(job->plan, job->input_data, job->input_length));
+        release_ref(job);
+    
+        pthread_mutex_lock(&ex->lock);
+        ex->running[start.index] = NULL;
+        // A job skipped because this plan was busy may be runnable now
+        pthread_cond_broadcast(&ex->wake);
+    }
+    pthread_mutex_unlock(&ex->lock);
+    return NULL;
+}
+
+static void executor_destroy(Executor *ex) {
+    pthread_mutex_lock(&ex->lock);
+    ex->shutdown = true;
+    pthread_cond_broadcast(&ex->wake);
+    pthread_mutex_unlock(&ex->lock);
+    
+    for (int t = 0; t < ex->thread_count; t++) {
+        pthread_join(ex->threads[t], NULL);
+    }
+    pthread_cond_destroy(&ex->wake);
+    pthread_mutex_destroy(&ex->lock);
+    free(ex->threads);
+    free(ex->running);
+    free(ex);
+}
+
+static Executor* executor_create(void) {
+    Executor *ex = (Executor*)calloc(1, sizeof(Executor));
+    if (!ex) return NULL;
+    
+    int thread_count = stft_pool_default_size();
+    ex->threads = (pthread_t*)calloc(thread_count, sizeof(pthread_t));
+    ex->running = (STFTPlan**)calloc(thread_count, sizeof(STFTPlan*));
+    if (!ex->threads || !ex->running) {
+        free(ex->threads);
+        free(ex->running);
+        free(ex);
+        return NULL;
+    }
+    pthread_mutex_init(&ex->lock, NULL);
+    pthread_cond_init(&ex->wake, NULL);
+    
+    for (int t = 0; t < thread_count; t++) {
+        ExecutorStart *start = (ExecutorStart*)malloc(sizeof(ExecutorStart));
+        if (!start) break;
+        start->ex = ex;
+        start->index = t;
+        if (pthread_create(&ex->threads[t], NULL, executor_main, start) != 0) {
+            free(start);
+            break;
+        }
+        ex->thread_count++;
+    }
+    
+    if (ex->thread_count == 0) {
+        executor_destroy(ex);
+        return NULL;
+    }
+    return ex;
+}
+
+STFTJob* stft_submit(STFTPlan *plan, const float *input_data, int input_length, STFTResult **out,
+                     STFTCompletionCallback callback, void *user_data) {
+    if (!plan) return NULL;
+    
+    STFTJob *job = (STFTJob*)calloc(1, sizeof(STFTJob));
+    if (!job) return NULL;
+    job->plan = plan;
+    job->input_data = input_data;
+    job->input_length = input_length;
+    job->out = out;
+    job->callback = callback;
+    job->user_data = user_data;
+    job->refs = 2;
+    job->event_fd = -1;
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->finished, NULL);
+    
+    pthread_mutex_lock(&executor_lock);
+    if (!executor) executor = executor_create();
+    Executor *ex = executor;
+    if (ex) {
+        pthread_mutex_lock(&ex->lock);
+        if (ex->tail) ex->tail->next = job;
+        else ex->head = job;
+        ex->tail = job;
+        pthread_cond_signal(&ex->wake);
+        pthread_mutex_unlock(&ex->lock);
+    }
+    pthread_mutex_unlock(&executor_lock);
+    
+    if (!ex) {
+        pthread_cond_destroy(&job->finished);
+        pthread_mutex_destroy(&job->lock);
+        free(job);
+        return NULL;
+    }
+    return job;
+}
+
+bool stft_job_poll(const STFTJob *job) {
+    return __atomic_load_n(&job->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+STFTResult* stft_job_wait(STFTJob *job) {
+    pthread_mutex_lock(&job->lock);
+    while (!job->done) {
+        pthread_cond_wait(&job->finished, &job->lock);
+    }
+    STFTResult *result = job->result;
+    pthread_mutex_unlock(&job->lock);
+    return result;
+}
+
+int stft_job_eventfd(STFTJob *job) {
+#if defined(__linux__)
+    pthread_mutex_lock(&job->lock);
+    if (job->event_fd < 0) {
+        job->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        // Asked for after completion: make it readable straight away
+        if (job->event_fd >= 0 && job->done) {
+            uint64_t one = 1;
+            ssize_t written = write(job->event_fd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+    int fd = job->event_fd;
+    pthread_mutex_unlock(&job->lock);
+    return fd;
+#else
+    (void)job;
+    return -1;
+#endif
+}
+
+void stft_job_release(STFTJob *job) {
+    if (job) release_ref(job);
+}
+
+void stft_async_shutdown(void) {
+    pthread_mutex_lock(&executor_lock);
+    Executor *ex = executor;
+    executor = NULL;
+    pthread_mutex_unlock(&executor_lock);
+    
+    if (ex) executor_destroy(ex);
+}
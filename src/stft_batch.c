@@ -0,0 +1,258 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stft_batch.h"
+#include "stft_internal.h"
+#include "stft_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A run of frames from one job; a task is one or more consecutive spans
+typedef struct {
+    int job;
+    int first_frame;
+    int frame_count;
+} BatchSpan;
+
+// Per-thread state, rebuilt only when the next span needs different analysis parameters
+typedef struct {
+    STFTFrameEngine engine;
+    const STFTParameters *engine_params;    // NULL until the engine is first built
+    kiss_fft_cpx *staging;
+    int staging_bins;
+    float *resampled;           // one block of resampled frames for jobs that resample
+    size_t resampled_samples;
+} BatchWorker;
+
+typedef struct {
+    const STFTBatchJob *jobs;
+    STFTResampler **resamplers; // [job_count], NULL for jobs analyzed at their input rate
+    STFTResult **results;
+    bool *job_failed;
+    const BatchSpan *spans;
+    const int *task_spans;      // [task_count + 1]: task t covers spans [task_spans[t], task_spans[t + 1])
+    BatchWorker *workers;
+} BatchRun;
+
+BatchOptions batch_default_options(void) {
+    BatchOptions options = {
+        .thread_count = 0,
+        .target_frames = 256
+    };
+    return options;
+}
+
+// PSD scaling and the gate energy are folded into the engine window, and both depend on the rate
+static bool same_engine(const STFTParameters *a, const STFTParameters *b) {
+    return a == b || (a->window_size == b->window_size && a->window_type == b->window_type &&
+                      a->scaling == b->scaling && a->energy_gate == b->energy_gate &&
+                      a->gate_threshold_db == b->gate_threshold_db && a->format == b->format &&
+                      stft_analysis_rate(a) == stft_analysis_rate(b));
+}
+
+static bool prepare_worker(BatchWorker *worker, const STFTParameters *params, bool resamples) {
+    if (!worker->engine_params || !same_engine(worker->engine_params, params)) {
+        if (worker->engine_params) stft_engine_destroy(&worker->engine);
+        worker->engine_params = NULL;
+    
+        char *error = stft_engine_init(&worker->engine, params, NULL);
+        if (error) {
+            free(error);
+            return false;
+        }
+        worker->engine_params = params;
+    }
+    
+    if (params->layout == LAYOUT_BIN_MAJOR && worker->staging_bins < worker->engine.bin_count) {
+        free(worker->staging);
+        worker->staging = (kiss_fft_cpx*)malloc((size_t)TRANSPOSE_BLOCK_FRAMES * worker->engine.bin_count * sizeof(kiss_fft_cpx));
+        worker->staging_bins = worker->staging ? worker->engine.bin_count : 0;
+        if (!worker->staging) return false;
+    }
+    
+    if (resamples && worker->resampled_samples < stft_resampled_block_samples(params)) {
+        free(worker->resampled);
+        worker->resampled = (float*)malloc(stft_resampled_block_samples(params) * sizeof(float));
+        worker->resampled_samples = worker->resampled ? stft_resampled_block_samples(params) : 0;
+        if (!worker->resampled) return false;
+    }
+    return true;
+}
+
+static void run_batch_task(void *arg, int task_index, int worker_index) {
+    BatchRun *run = (BatchRun*)arg;
+    BatchWorker *worker = &run->workers[worker_index];
+    
+    for (int s = run->task_spans[task_index]; s < run->task_spans[task_index + 1]; s++) {
+        const BatchSpan *span = &run->spans[s];
+        const STFTBatchJob *job = &run->jobs[span->job];
+        const STFTResampler *resampler = run->resamplers[span->job];
+        if (!prepare_worker(worker, job->params, resampler != NULL)) {
+            __atomic_store_n(&run->job_failed[span->job], true, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (resampler) {
+            stft_result_fill_resampled(&worker->engine, job->params, run->results[span->job], resampler, job->input_data,
+                                       job->input_length, span->first_frame, span->frame_count, worker->staging,
+                                       worker->resampled);
+        } else {
+            stft_result_fill(&worker->engine, job->params, run->results[span->job],
+                             job->input_data + (size_t)span->first_frame * job->params->hop_size,
+                             span->first_frame, span->frame_count, worker->staging);
+        }
+    }
+}
+
+static STFTResult* failed_job_result(char *message) {
+    STFTResult *result = (STFTResult*)calloc(1, sizeof(STFTResult));
+    if (!result) {
+        free(message);
+        return NULL;
+    }
+    result->success = false;
+    result->message = message;
+    return result;
+}
+
+static void free_resamplers(STFTResampler **resamplers, int job_count) {
+    for (int j = 0; resamplers && j < job_count; j++) {
+        stft_resampler_free(resamplers[j]);
+    }
+    free(resamplers);
+}
+
+static BatchResult* batch_error(BatchResult *result, const char *message) {
+    result->success = false;
+    result->message = strdup(message);
+    return result;
+}
+
+BatchResult* perform_stft_batch(const STFTBatchJob *jobs, int job_count, const BatchOptions *options) {
+    BatchResult *result = (BatchResult*)calloc(1, sizeof(BatchResult));
+    if (!result) return NULL;
+    
+    if (!jobs || job_count <= 0) {
+        return batch_error(result, "Batch needs at least one job");
+    }
+    
+    BatchOptions defaults = batch_default_options();
+    if (!options) options = &defaults;
+    int target_frames = options->target_frames > 0 ? options->target_frames : defaults.target_frames;
+    // Whole transpose blocks per span, so split jobs never share a staging block or gate byte
+    target_frames = (target_frames + TRANSPOSE_BLOCK_FRAMES - 1) / TRANSPOSE_BLOCK_FRAMES * TRANSPOSE_BLOCK_FRAMES;
+    
+    result->results = (STFTResult**)calloc(job_count, sizeof(STFTResult*));
+    STFTResampler **resamplers = (STFTResampler**)calloc(job_count, sizeof(STFTResampler*));
+    if (!result->results || !resamplers) {
+        free(resamplers);
+        return batch_error(result, "Failed to allocate batch results");
+    }
+    result->job_count = job_count;
+    
+    // Results and resamplers are allocated up front on this thread; workers only fill them in,
+    // resampling each span as they transform it
+    int span_total = 0;
+    for (int j = 0; j < job_count; j++) {
+        char *error = jobs[j].params ? stft_validate_parameters(jobs[j].params) : strdup("Job parameters are NULL");
+        if (!error && stft_resamples(jobs[j].params)) {
+            resamplers[j] = stft_params_resampler(jobs[j].params, NULL);
+            if (!resamplers[j]) error = strdup("Failed to allocate resampler");
+        }
+        result->results[j] = error ? failed_job_result(error)
+                                   : stft_result_create(jobs[j].params, jobs[j].input_data,
+                                                        stft_get_analysis_length(jobs[j].params, jobs[j].input_length), NULL);
+        if (!result->results[j]) {
+            free_resamplers(resamplers, job_count);
+            batch_free_result(result);
+            return NULL;
+        }
+        if (result->results[j]->success) {
+            int frames = result->results[j]->frame_count;
+            span_total += frames > target_frames ? (frames + target_frames - 1) / target_frames : 1;
+        }
+    }
+    
+    BatchSpan *spans = (BatchSpan*)malloc((span_total + 1) * sizeof(BatchSpan));
+    int *task_spans = (int*)malloc((span_total + 1) * sizeof(int));
+    bool *job_failed = (bool*)calloc(job_count, sizeof(bool));
+    
+    int pool_size = options->thread_count > 0 ? options->thread_count : stft_pool_default_size();
+    STFTPool *pool = stft_pool_create(pool_size, false);
+    BatchWorker *workers = pool ? (BatchWorker*)calloc(stft_pool_size(pool), sizeof(BatchWorker)) : NULL;
+    
+    if (!spans || !task_spans || !job_failed || !workers) {
+        free(spans);
+        free(task_spans);
+        free(job_failed);
+        free(workers);
+        free_resamplers(resamplers, job_count);
+        stft_pool_destroy(pool);
+        return batch_error(result, "Failed to allocate batch schedule");
+    }
+    
+    // Long jobs become one task per target_frames; short ones share a task until it is full
+    int span_count = 0;
+    int task_count = 0;
+    int packed_frames = 0;
+    task_spans[0] = 0;
+    for (int j = 0; j < job_count; j++) {
+        if (!result->results[j]->success) continue;
+        int frames = result->results[j]->frame_count;
+    
+        if (frames > target_frames) {
+            if (packed_frames > 0) {
+                task_spans[++task_count] = span_count;
+                packed_frames = 0;
+            }
+            for (int first = 0; first < frames; first += target_frames) {
+                int count = frames - first < target_frames ? frames - first : target_frames;
+                spans[span_count++] = (BatchSpan){ j, first, count };
+                task_spans[++task_count] = span_count;
+            }
+        } else {
+            spans[span_count++] = (BatchSpan){ j, 0, frames };
+            packed_frames += frames;
+            if (packed_frames >= target_frames) {
+                task_spans[++task_count] = span_count;
+                packed_frames = 0;
+            }
+        }
+    }
+    if (packed_frames > 0) task_spans[++task_count] = span_count;
+    
+    BatchRun run = { jobs, resamplers, result->results, job_failed, spans, task_spans, workers };
+    stft_pool_run(pool, task_count, run_batch_task, &run);
+    
+    for (int w = 0; w < stft_pool_size(pool); w++) {
+        if (workers[w].engine_params) stft_engine_destroy(&workers[w].engine);
+        free(workers[w].staging);
+        free(workers[w].resampled);
+    }
+    stft_pool_destroy(pool);
+    
+    for (int j = 0; j < job_count; j++) {
+        if (job_failed[j]) {
+            stft_free_result(result->results[j]);
+            result->results[j] = failed_job_result(strdup("Failed to allocate batch worker state"));
+        }
+        if (!result->results[j] || !result->results[j]->success) result->failed_count++;
+    }
+    
+    free(spans);
+    free(task_spans);
+    free(job_failed);
+    free(workers);
+    free_resamplers(resamplers, job_count);
+    
+    result->success = true;
+    result->message = strdup(result->failed_count ? "Batch finished with failed jobs" : "Batch computation successful");
+    return result;
+}
+
+void batch_free_result(BatchResult *result) {
+    if (!result) return;
+    for (int j = 0; result->results && j < result->job_count; j++) {
+        stft_free_result(result->results[j]);
+    }
+    free(result->results);
+    free(result->message);
+    free(result);
+}
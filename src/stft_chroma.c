@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stft_chroma.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+ChromaMap* chroma_map_create(double sample_rate, int window_size, double tuning_hz, double min_hz, double max_hz) {
+    if (sample_rate <= 0 || window_size <= 0 || tuning_hz <= 0) return NULL;
+    
+    ChromaMap *map = (ChromaMap*)calloc(1, sizeof(ChromaMap));
+    if (!map) return NULL;
+    
+    int frequency_bin_count = window_size / 2 + 1;
+    map->sample_rate = sample_rate;
+    map->window_size = window_size;
+    map->bin_index = (int*)malloc(2 * frequency_bin_count * sizeof(int));
+    map->pitch_class = (int*)malloc(2 * frequency_bin_count * sizeof(int));
+    map->weight = (float*)malloc(2 * frequency_bin_count * sizeof(float));
+    if (!map->bin_index || !map->pitch_class || !map->weight) {
+        chroma_map_free(map);
+        return NULL;
+    }
+    
+    // Skip DC: it has no pitch and would otherwise dominate every frame
+    for (int bin = 1; bin < frequency_bin_count; bin++) {
+        double frequency = bin * sample_rate / window_size;
+        if (frequency < min_hz || frequency > max_hz) continue;
+        
+        // Fractional MIDI note number, folded onto the 12 pitch classes
+        double note = 69.0 + 12.0 * log2(frequency / tuning_hz);
+        double nearest = floor(note + 0.5);
+        double offset = note - nearest;     // [-0.5, 0.5]
+        int pitch_class = ((int)nearest % CHROMA_BIN_COUNT + CHROMA_BIN_COUNT) % CHROMA_BIN_COUNT;
+        int neighbour = (pitch_class + (offset >= 0 ? 1 : CHROMA_BIN_COUNT - 1)) % CHROMA_BIN_COUNT;
+        
+        map->bin_index[map->entry_count] = bin;
+        map->pitch_class[map->entry_count] = pitch_class;
+        map->weight[map->entry_count] = (float)(1.0 - fabs(offset));
+        map->entry_count++;
+        
+        if (offset != 0.0) {
+            map->bin_index[map->entry_count] = bin;
+            map->pitch_class[map->entry_count] = neighbour;
+            map->weight[map->entry_count] = (float)fabs(offset);
+            map->entry_count++;
+        }
+    }
+    
+    return map;
+}
+
+void chroma_map_free(ChromaMap *map) {
+    if (!map) return;
+    
+    free(map->bin_index);
+    free(map->pitch_class);
+    free(map->weight);
+    free(map);
+}
+
+void chroma_map_apply(const ChromaMap *map, const kiss_fft_cpx *bins, float *chroma) {
+    memset(chroma, 0, CHROMA_BIN_COUNT * sizeof(float));
+    
+    for (int e = 0; e < map->entry_count; e++) {
+        kiss_fft_cpx c = bins[map->bin_index[e]];
+        chroma[map->pitch_class[e]] += map->weight[e] * (c.r * c.r + c.i * c.i);
+    }
+}
+
+typedef struct {
+    const ChromaMap *map;
+    float *chroma;
+} ChromaPass;
+
+static void accumulate_chroma_frame(const STFTFrame *frame, void *user_data) {
+    ChromaPass *pass = (ChromaPass*)user_data;
+    float *chroma = pass->chroma + (size_t)frame->index * CHROMA_BIN_COUNT;
+    
+    chroma_map_apply(pass->map, frame->bins, chroma);
+    
+    float peak = 0.0f;
+    for (int pc = 0; pc < CHROMA_BIN_COUNT; pc++) {
+        if (chroma[pc] > peak) peak = chroma[pc];
+    }
+    if (peak > 0.0f) {
+        for (int pc = 0; pc < CHROMA_BIN_COUNT; pc++) {
+            chroma[pc] /= peak;
+        }
+    }
+}
+
+ChromaResult* perform_stft_chroma(const float *input_data, int input_length, const STFTParameters *params, const ChromaMap *map) {
+    ChromaResult *result = (ChromaResult*)calloc(1, sizeof(ChromaResult));
+    if (!result) return NULL;
+    
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) {
+        result->success = false;
+        result->message = validation_error;
+        return result;
+    }
+    
+    ChromaMap *owned_map = NULL;
+    if (!map) {
+        owned_map = chroma_map_create(stft_analysis_rate(params), params->window_size, 440.0, 55.0, 5000.0);
+        if (!owned_map) {
+            result->success = false;
+            result->message = strdup("Failed to build chroma map");
+            return result;
+        }
+        map = owned_map;
+    } else if (map->window_size != params->window_size || map->sample_rate != stft_analysis_rate(params)) {
+        result->success = false;
+        result->message = strdup("Chroma map does not match window size and sample rate");
+        return result;
+    }
+    
+    int frame_count = stft_get_frame_count(params, input_length);
+    if (frame_count > 0) {
+        result->chroma = (float*)malloc((size_t)frame_count * CHROMA_BIN_COUNT * sizeof(float));
+        if (!result->chroma) {
+            chroma_map_free(owned_map);
+            result->success = false;
+            result->message = strdup("Failed to allocate chroma memory");
+            return result;
+        }
+    }
+    
+    ChromaPass pass = { map, result->chroma };
+    char *error = stft_process_frames(input_data, input_length, params, accumulate_chroma_frame, &pass);
+    chroma_map_free(owned_map);
+    
+    if (error) {
+        free(result->chroma);
+        result->chroma = NULL;
+        result->success = false;
+        result->message = error;
+        return result;
+    }
+    
+    result->success = true;
+    result->frame_count = frame_count;
+    result->frame_time = stft_get_frame_time(params);
+    result->message = strdup("Chroma computation successful");
+    
+    return result;
+}
+
+void chroma_free_result(ChromaResult *result) {
+    if (!result) return;
+    
+    free(result->chroma);
+    free(result->message);
+    free(result);
+}
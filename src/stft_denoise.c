@@ -0,0 +1,275 @@
+#include "../include/stft_denoise.h"
+#include "../include/stft_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define NOISE_SUBWINDOWS 8
+#define MIN_STATISTICS_BIAS 1.5f
+#define SPEECH_PRESENCE_RATIO 5.0f
+
+struct Denoiser {
+    DenoiseOptions options;
+    STFTStream *stream;
+    STFTSynthesis *synthesis;
+    int window_size;
+    int hop_size;
+    int bin_count;
+    int frames_seen;
+    int lead_frames;                // frames that still overlap the silent lead-in
+    int subwindow_frames;           // frames per minimum-statistics subwindow
+    float gain_floor;
+    
+    float *smoothed_power;          // [bin]
+    float *noise_power;             // [bin]
+    float *speech_presence;         // [bin]
+    float *previous_clean_power;    // [bin]
+    float *subwindow_minimum;       // [bin * NOISE_SUBWINDOWS], ring of past subwindow minima
+    float *current_minimum;         // [bin]
+    int subwindow_slot;
+    
+    float *frame_power;             // [bin]
+    kiss_fft_cpx *cleaned;          // [bin]
+    float *synthesis_output;        // [hop_size]
+    float *output_queue;            // 2 * hop_size finished samples awaiting delivery
+    int queue_start;
+    int queue_count;
+};
+
+DenoiseOptions denoise_default_options(void) {
+    DenoiseOptions options = {
+        .gain_rule = DENOISE_WIENER,
+        .noise_estimator = NOISE_MINIMUM_STATISTICS,
+        .power_smoothing = 0.85f,
+        .noise_window_seconds = 1.5f,
+        .noise_smoothing = 0.95f,
+        .over_subtraction = 2.0f,
+        .decision_directed = 0.98f,
+        .gain_floor_db = -20.0f
+    };
+    return options;
+}
+
+void denoiser_reset(Denoiser *denoiser) {
+    stft_stream_reset(denoiser->stream);
+    stft_synthesis_reset(denoiser->synthesis);
+    denoiser->frames_seen = 0;
+    denoiser->subwindow_slot = 0;
+    
+    // Start the analysis window window_size - hop_size samples "early" so every hop of input
+    // completes a frame, and pre-queue one hop of silence so a call can always be answered in full.
+    float silence[64] = {0};
+    int lead = denoiser->window_size - denoiser->hop_size;
+    while (lead > 0) {
+        int chunk = lead < 64 ? lead : 64;
+        stft_stream_push(denoiser->stream, silence, chunk, NULL, NULL);
+        lead -= chunk;
+    }
+    memset(denoiser->output_queue, 0, 2 * denoiser->hop_size * sizeof(float));
+    denoiser->queue_start = 0;
+    denoiser->queue_count = denoiser->hop_size;
+}
+
+Denoiser* denoiser_create(const STFTParameters *params, const DenoiseOptions *options) {
+    if (!params) return NULL;
+    char *error = stft_validate_parameters(params);
+    if (error) {
+        free(error);
+        return NULL;
+    }
+    
+    DenoiseOptions defaults = denoise_default_options();
+    if (!options) options = &defaults;
+    
+    Denoiser *denoiser = (Denoiser*)calloc(1, sizeof(Denoiser));
+    if (!denoiser) return NULL;
+    
+    int bin_count = params->window_size / 2 + 1;
+    denoiser->options = *options;
+    denoiser->window_size = params->window_size;
+    denoiser->hop_size = params->hop_size;
+    denoiser->bin_count = bin_count;
+    denoiser->lead_frames = (params->window_size - params->hop_size + params->hop_size - 1) / params->hop_size;
+    denoiser->gain_floor = powf(10.0f, options->gain_floor_db / 20.0f);
+    
+    double frames_per_second = params->sample_rate / params->hop_size;
+    denoiser->subwindow_frames = (int)ceil(options->noise_window_seconds * frames_per_second / NOISE_SUBWINDOWS);
+    if (denoiser->subwindow_frames < 1) denoiser->subwindow_frames = 1;
+    
+    // Output is sample-aligned with the input, so the denoiser always analyzes at the input rate
+    STFTParameters stream_params = *params;
+    stream_params.resample_up = stream_params.resample_down = 0;
+    stream_params.target_sample_rate = 0.0;
+    denoiser->stream = stft_stream_create(&stream_params);
+    denoiser->synthesis = stft_synthesis_create(&stream_params);
+    denoiser->smoothed_power = (float*)malloc(bin_count * sizeof(float));
+    denoiser->noise_power = (float*)malloc(bin_count * sizeof(float));
+    denoiser->speech_presence = (float*)malloc(bin_count * sizeof(float));
+    denoiser->previous_clean_power = (float*)malloc(bin_count * sizeof(float));
+    denoiser->subwindow_minimum = (float*)malloc((size_t)bin_count * NOISE_SUBWINDOWS * sizeof(float));
+    denoiser->current_minimum = (float*)malloc(bin_count * sizeof(float));
+    denoiser->frame_power = (float*)malloc(bin_count * sizeof(float));
+    denoiser->cleaned = (kiss_fft_cpx*)malloc(bin_count * sizeof(kiss_fft_cpx));
+    denoiser->synthesis_output = (float*)malloc(params->hop_size * sizeof(float));
+    denoiser->output_queue = (float*)malloc(2 * params->hop_size * sizeof(float));
+    
+    if (!denoiser->stream || !denoiser->synthesis || !denoiser->smoothed_power || !denoiser->noise_power || !denoiser->speech_presence ||
+        !denoiser->previous_clean_power || !denoiser->subwindow_minimum || !denoiser->current_minimum ||
+        !denoiser->frame_power || !denoiser->cleaned || !denoiser->synthesis_output || !denoiser->output_queue) {
+        denoiser_free(denoiser);
+        return NULL;
+    }
+    
+    denoiser_reset(denoiser);
+    return denoiser;
+}
+
+int denoiser_latency(const Denoiser *denoiser) {
+    return denoiser->window_size;
+}
+
+static void update_noise_estimate(Denoiser *denoiser, const float *power) {
+    const DenoiseOptions *options = &denoiser->options;
+    int bin_count = denoiser->bin_count;
+    
+    if (denoiser->frames_seen == 0) {
+        for (int bin = 0; bin < bin_count; bin++) {
+            denoiser->smoothed_power[bin] = power[bin];
+            denoiser->noise_power[bin] = power[bin];
+            denoiser->speech_presence[bin] = 0.0f;
+            denoiser->previous_clean_power[bin] = 0.0f;
+            denoiser->current_minimum[bin] = power[bin];
+            for (int u = 0; u < NOISE_SUBWINDOWS; u++) {
+                denoiser->subwindow_minimum[bin * NOISE_SUBWINDOWS + u] = power[bin];
+            }
+        }
+        return;
+    }
+    
+    // Both estimators track the minimum of the smoothed power over NOISE_SUBWINDOWS
+    // subwindows, so the search span slides without storing every frame.
+    float alpha = options->power_smoothing;
+    bool close_subwindow = denoiser->frames_seen % denoiser->subwindow_frames == 0;
+    for (int bin = 0; bin < bin_count; bin++) {
+        float smoothed = alpha * denoiser->smoothed_power[bin] + (1.0f - alpha) * power[bin];
+        denoiser->smoothed_power[bin] = smoothed;
+        if (smoothed < denoiser->current_minimum[bin]) denoiser->current_minimum[bin] = smoothed;
+        
+        float *history = denoiser->subwindow_minimum + (size_t)bin * NOISE_SUBWINDOWS;
+        float minimum = denoiser->current_minimum[bin];
+        for (int u = 0; u < NOISE_SUBWINDOWS; u++) {
+            if (history[u] < minimum) minimum = history[u];
+        }
+        
+        if (options->noise_estimator == NOISE_MINIMUM_STATISTICS) {
+            denoiser->noise_power[bin] = MIN_STATISTICS_BIAS * minimum;
+        } else {
+            // Recursive averaging, slowed down in proportion to the speech presence
+            // probability (smoothed power well above its minimum means speech).
+            float present = smoothed > SPEECH_PRESENCE_RATIO * minimum ? 1.0f : 0.0f;
+            float presence = 0.8f * denoiser->speech_presence[bin] + 0.2f * present;
+            float rate = options->noise_smoothing + (1.0f - options->noise_smoothing) * presence;
+            denoiser->speech_presence[bin] = presence;
+            denoiser->noise_power[bin] = rate * denoiser->noise_power[bin] + (1.0f - rate) * power[bin];
+        }
+        
+        if (close_subwindow) {
+            history[denoiser->subwindow_slot] = denoiser->current_minimum[bin];
+            denoiser->current_minimum[bin] = smoothed;
+        }
+    }
+    if (close_subwindow) {
+        denoiser->subwindow_slot = (denoiser->subwindow_slot + 1) % NOISE_SUBWINDOWS;
+    }
+}
+
+static void denoise_frame(const STFTFrame *frame, void *user_data) {
+    Denoiser *denoiser = (Denoiser*)user_data;
+    const DenoiseOptions *options = &denoiser->options;
+    float *power = denoiser->frame_power;
+    
+    for (int bin = 0; bin < frame->bin_count; bin++) {
+        power[bin] = frame->bins[bin].r * frame->bins[bin].r + frame->bins[bin].i * frame->bins[bin].i;
+    }
+    
+    // The first frames overlap the silent lead-in and would seed the noise floor near zero
+    bool warming_up = frame->index < denoiser->lead_frames;
+    if (!warming_up) {
+        update_noise_estimate(denoiser, power);
+        denoiser->frames_seen++;
+    }
+    
+    for (int bin = 0; bin < frame->bin_count; bin++) {
+        if (warming_up) {
+            denoiser->cleaned[bin].r = frame->bins[bin].r * denoiser->gain_floor;
+            denoiser->cleaned[bin].i = frame->bins[bin].i * denoiser->gain_floor;
+            continue;
+        }
+        
+        float noise = fmaxf(denoiser->noise_power[bin], 1e-30f);
+        float gain;
+        
+        if (options->gain_rule == DENOISE_SPECTRAL_SUBTRACTION) {
+            float remaining = power[bin] > 0.0f ? 1.0f - options->over_subtraction * noise / power[bin] : 0.0f;
+            gain = sqrtf(fmaxf(remaining, 0.0f));
+        } else {
+            float posterior_snr = power[bin] / noise;
+            float prior_snr = options->decision_directed * denoiser->previous_clean_power[bin] / noise
+                            + (1.0f - options->decision_directed) * fmaxf(posterior_snr - 1.0f, 0.0f);
+            gain = prior_snr / (1.0f + prior_snr);
+        }
+        if (gain < denoiser->gain_floor) gain = denoiser->gain_floor;
+        
+        denoiser->previous_clean_power[bin] = gain * gain * power[bin];
+        denoiser->cleaned[bin].r = frame->bins[bin].r * gain;
+        denoiser->cleaned[bin].i = frame->bins[bin].i * gain;
+    }
+    
+    int hop_size = denoiser->hop_size;
+    int tail = (denoiser->queue_start + denoiser->queue_count) % (2 * hop_size);
+    float *output = denoiser->synthesis_output;
+    stft_synthesis_push(denoiser->synthesis, denoiser->cleaned, output);
+    for (int i = 0; i < hop_size; i++) {
+        denoiser->output_queue[(tail + i) % (2 * hop_size)] = output[i];
+    }
+    denoiser->queue_count += hop_size;
+}
+
+void denoiser_process(Denoiser *denoiser, const float *input, int count, float *output) {
+    int hop_size = denoiser->hop_size;
+    int capacity = 2 * hop_size;
+    
+    while (count > 0) {
+        // At most one frame per push keeps the queue within two hops
+        int chunk = stft_stream_samples_until_frame(denoiser->stream);
+        if (chunk > count) chunk = count;
+        stft_stream_push(denoiser->stream, input, chunk, denoise_frame, denoiser);
+        input += chunk;
+        count -= chunk;
+        
+        for (int i = 0; i < chunk; i++) {
+            output[i] = denoiser->output_queue[denoiser->queue_start];
+            denoiser->queue_start = (denoiser->queue_start + 1) % capacity;
+        }
+        denoiser->queue_count -= chunk;
+        output += chunk;
+    }
+}
+
+void denoiser_free(Denoiser *denoiser) {
+    if (!denoiser) return;
+    
+    stft_stream_free(denoiser->stream);
+    stft_synthesis_free(denoiser->synthesis);
+    free(denoiser->smoothed_power);
+    free(denoiser->noise_power);
+    free(denoiser->speech_presence);
+    free(denoiser->previous_clean_power);
+    free(denoiser->subwindow_minimum);
+    free(denoiser->current_minimum);
+    free(denoiser->frame_power);
+    free(denoiser->cleaned);
+    free(denoiser->synthesis_output);
+    free(denoiser->output_queue);
+    free(denoiser);
+}
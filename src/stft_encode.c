@@ -0,0 +1,344 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stft_encode.h"
+#include "stft_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__) || defined(__AVX512BF16__)
+#include <immintrin.h>
+#endif
+
+EncodeOptions encode_default_options(void) {
+    EncodeOptions options;
+    options.encoding = ENCODE_U8_DB;
+    options.min_db = -120.0f;
+    options.max_db = 0.0f;
+    return options;
+}
+
+size_t encode_element_size(SpectrogramEncoding encoding) {
+    return encoding == ENCODE_U8_DB ? sizeof(uint8_t) : sizeof(uint16_t);
+}
+
+uint16_t stft_float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+    
+    uint16_t half;
+    if (bits >= 0x47800000u) {
+        // >= 65536 (or Inf/NaN): overflows to Inf, NaN stays quiet NaN
+        half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    } else if (bits < 0x38800000u) {
+        // Subnormal half: let the FPU round by adding a magic constant that aligns the mantissa
+        const uint32_t magic_bits = 126u << 23;
+        float magic, sum;
+        memcpy(&magic, &magic_bits, sizeof(magic));
+        memcpy(&sum, &bits, sizeof(sum));
+        sum += magic;
+        memcpy(&bits, &sum, sizeof(bits));
+        half = (uint16_t)(bits - magic_bits);
+    } else {
+        // Rebias the exponent and round to nearest even on the 13 dropped mantissa bits
+        uint32_t odd = (bits >> 13) & 1u;
+        bits += 0xc8000fffu + odd;
+        half = (uint16_t)(bits >> 13);
+    }
+    return half | (uint16_t)(sign >> 16);
+}
+
+float stft_half_to_float(uint16_t value) {
+    uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    
+    if (exponent == 0) {
+        float magnitude = ldexpf((float)mantissa, -24);
+        return sign ? -magnitude : magnitude;
+    }
+    
+    uint32_t bits = exponent == 0x1fu ? sign | 0x7f800000u | (mantissa << 13)
+                                      : sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+uint16_t stft_float_to_bf16(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u) return (uint16_t)((bits >> 16) | 0x40u);
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return (uint16_t)(bits >> 16);
+}
+
+float stft_bf16_to_float(uint16_t value) {
+    uint32_t bits = (uint32_t)value << 16;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static void quantize_row(const float *db, int count, float min_db, float max_db, int levels, void *output) {
+    float scale = levels / (max_db - min_db);
+    int i = 0;
+    
+    if (levels == 255) {
+        uint8_t *out = (uint8_t*)output;
+#if defined(__SSE2__)
+        // 16 values per iteration; cvtps rounds to nearest even like lrintf, packus saturates
+        __m128 min_vec = _mm_set1_ps(min_db);
+        __m128 scale_vec = _mm_set1_ps(scale);
+        __m128 zero = _mm_setzero_ps();
+        __m128 top = _mm_set1_ps(255.0f);
+        for (; i + 16 <= count; i += 16) {
+            __m128i q[4];
+            for (int k = 0; k < 4; k++) {
+                __m128 x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(db + i + 4 * k), min_vec), scale_vec);
+                q[k] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, zero), top));
+            }
+            __m128i lo = _mm_packs_epi32(q[0], q[1]);
+            __m128i hi = _mm_packs_epi32(q[2], q[3]);
+            _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; i < count; i++) {
+            float x = fminf(fmaxf((db[i] - min_db) * scale, 0.0f), 255.0f);
+            out[i] = (uint8_t)lrintf(x);
+        }
+    } else {
+        uint16_t *out = (uint16_t*)output;
+        for (; i < count; i++) {
+            float x = fminf(fmaxf((db[i] - min_db) * scale, 0.0f), 65535.0f);
+            out[i] = (uint16_t)lrintf(x);
+        }
+    }
+}
+
+static void convert_row_f16(const float *db, int count, uint16_t *out) {
+    int i = 0;
+#if defined(__F16C__)
+    for (; i + 4 <= count; i += 4) {
+        __m128i half = _mm_cvtps_ph(_mm_loadu_ps(db + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64((__m128i*)(out + i), half);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = stft_float_to_half(db[i]);
+    }
+}
+
+static void convert_row_bf16(const float *db, int count, uint16_t *out) {
+    int i = 0;
+#if defined(__AVX512BF16__)
+    for (; i + 16 <= count; i += 16) {
+        __m256bh packed = _mm512_cvtneps_pbh(_mm512_loadu_ps(db + i));
+        _mm256_storeu_si256((__m256i*)(out + i), (__m256i)packed);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = stft_float_to_bf16(db[i]);
+    }
+}
+
+void encode_power_db_row(const kiss_fft_cpx *bins, int bin_count, const EncodeOptions *options,
+                         STFTAccuracy accuracy, float *scratch, void *output) {
+    // The dB row stays in L1 between the two passes; only the compact row reaches memory
+    stft_power_db_row(bins, bin_count, accuracy, scratch);
+    
+    switch (options->encoding) {
+        case ENCODE_U8_DB:
+            quantize_row(scratch, bin_count, options->min_db, options->max_db, 255, output);
+            break;
+        case ENCODE_U16_DB:
+            quantize_row(scratch, bin_count, options->min_db, options->max_db, 65535, output);
+            break;
+        case ENCODE_F16_DB:
+            convert_row_f16(scratch, bin_count, (uint16_t*)output);
+            break;
+        case ENCODE_BF16_DB:
+            convert_row_bf16(scratch, bin_count, (uint16_t*)output);
+            break;
+    }
+}
+
+void decode_power_db_row(const void *input, int count, const EncodeOptions *options, float *output) {
+    float range = options->max_db - options->min_db;
+    
+    switch (options->encoding) {
+        case ENCODE_U8_DB: {
+            const uint8_t *in = (const uint8_t*)input;
+            for (int i = 0; i < count; i++) {
+                output[i] = options->min_db + in[i] * (range / 255.0f);
+            }
+            break;
+        }
+        case ENCODE_U16_DB: {
+            const uint16_t *in = (const uint16_t*)input;
+            for (int i = 0; i < count; i++) {
+                output[i] = options->min_db + in[i] * (range / 65535.0f);
+            }
+            break;
+        }
+        case ENCODE_F16_DB: {
+            const uint16_t *in = (const uint16_t*)input;
+            for (int i = 0; i < count; i++) {
+                output[i] = stft_half_to_float(in[i]);
+            }
+            break;
+        }
+        case ENCODE_BF16_DB: {
+            const uint16_t *in = (const uint16_t*)input;
+            for (int i = 0; i < count; i++) {
+                output[i] = stft_bf16_to_float(in[i]);
+            }
+            break;
+        }
+    }
+}
+
+static char* validate_encode_options(const EncodeOptions *options) {
+    if (!options) return strdup("Encode options are NULL");
+    if (options->encoding < ENCODE_U8_DB || options->encoding > ENCODE_BF16_DB) {
+        return strdup("Unknown spectrogram encoding");
+    }
+    if ((options->encoding == ENCODE_U8_DB || options->encoding == ENCODE_U16_DB) &&
+        !(options->max_db > options->min_db)) {
+        return strdup("max_db must be greater than min_db");
+    }
+    return NULL;
+}
+
+static EncodedResult* create_encoded_result(int frame_count, int bin_count, const EncodeOptions *options) {
+    EncodedResult *result = (EncodedResult*)calloc(1, sizeof(EncodedResult));
+    if (!result) return NULL;
+    
+    char *error = validate_encode_options(options);
+    if (error) {
+        result->success = false;
+        result->message = error;
+        return result;
+    }
+    
+    result->encoding = options->encoding;
+    result->min_db = options->min_db;
+    result->max_db = options->max_db;
+    result->frequency_bin_count = bin_count;
+    
+    if (frame_count > 0) {
+        result->data = malloc((size_t)frame_count * bin_count * encode_element_size(options->encoding));
+        if (!result->data) {
+            result->success = false;
+            result->message = strdup("Failed to allocate encoded spectrogram memory");
+            return result;
+        }
+    }
+    
+    result->frame_count = frame_count;
+    result->success = true;
+    return result;
+}
+
+typedef struct {
+    EncodedResult *result;
+    const EncodeOptions *options;
+    STFTAccuracy accuracy;
+    float *scratch;
+    size_t row_bytes;
+} EncodePass;
+
+static void encode_frame(const STFTFrame *frame, void *user_data) {
+    EncodePass *pass = (EncodePass*)user_data;
+    uint8_t *row = (uint8_t*)pass->result->data + (size_t)frame->index * pass->row_bytes;
+    encode_power_db_row(frame->bins, frame->bin_count, pass->options, pass->accuracy, pass->scratch, row);
+}
+
+EncodedResult* perform_stft_encoded(const float *input_data, int input_length, const STFTParameters *params,
+                                    const EncodeOptions *options) {
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) {
+        EncodedResult *result = (EncodedResult*)calloc(1, sizeof(EncodedResult));
+        if (!result) {
+            free(validation_error);
+            return NULL;
+        }
+        result->success = false;
+        result->message = validation_error;
+        return result;
+    }
+    
+    int bin_count = params->window_size / 2 + 1;
+    EncodedResult *result = create_encoded_result(stft_get_frame_count(params, input_length), bin_count, options);
+    if (!result || !result->success) return result;
+    
+    EncodePass pass = { result, options, params->accuracy, NULL, (size_t)bin_count * encode_element_size(options->encoding) };
+    pass.scratch = (float*)malloc(bin_count * sizeof(float));
+    if (!pass.scratch) {
+        free(result->data);
+        result->data = NULL;
+        result->success = false;
+        result->message = strdup("Failed to allocate encoder scratch");
+        return result;
+    }
+    
+    char *error = stft_process_frames(input_data, input_length, params, encode_frame, &pass);
+    free(pass.scratch);
+    
+    if (error) {
+        free(result->data);
+        result->data = NULL;
+        result->success = false;
+        result->message = error;
+        return result;
+    }
+    
+    result->frame_time = stft_get_frame_time(params);
+    result->frequency_resolution = stft_get_frequency_resolution(params);
+    result->message = strdup("Encoded STFT computation completed successfully");
+    return result;
+}
+
+EncodedResult* stft_encode_result(const STFTResult *source, const EncodeOptions *options) {
+    if (!source || !source->success || !stft_result_has_spectrum(source)) return NULL;
+    
+    EncodedResult *result = create_encoded_result(source->frame_count, source->frequency_bin_count, options);
+    if (!result || !result->success) return result;
+    
+    float *scratch = (float*)malloc(source->frequency_bin_count * sizeof(float));
+    kiss_fft_cpx *gather = (kiss_fft_cpx*)malloc(source->frequency_bin_count * sizeof(kiss_fft_cpx));
+    if (!scratch || !gather) {
+        free(scratch);
+        free(gather);
+        free(result->data);
+        result->data = NULL;
+        result->success = false;
+        result->message = strdup("Failed to allocate encoder scratch");
+        return result;
+    }
+    
+    size_t row_bytes = (size_t)source->frequency_bin_count * encode_element_size(options->encoding);
+    for (int frame = 0; frame < source->frame_count; frame++) {
+        encode_power_db_row(stft_get_frame(source, frame, gather), source->frequency_bin_count, options,
+                            source->accuracy, scratch, (uint8_t*)result->data + frame * row_bytes);
+    }
+    free(scratch);
+    free(gather);
+    
+    result->frame_time = source->frame_time;
+    result->frequency_resolution = source->frequency_resolution;
+    result->message = strdup("Spectrogram encoded successfully");
+    return result;
+}
+
+void encoded_free_result(EncodedResult *result) {
+    if (!result) return;
+    
+    free(result->data);
+    free(result->message);
+    free(result);
+}
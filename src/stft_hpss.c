@@ -0,0 +1,353 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stft_hpss.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Sliding median over a fixed odd-length window using two indexed heaps that meet at
+ * the median: a max-heap of the smaller half at negative heap positions and a min-heap
+ * of the larger half at positive ones. Replacing the oldest value re-heapifies only the
+ * path it moves along, so each update is O(log k) rather than a sort per window.
+ */
+typedef struct {
+    float *data;    // circular window, oldest value at data[oldest]
+    int *pos;       // heap position of each data slot
+    int *heap;      // points at the middle of its storage; heap[0] is the median
+    int size;
+    int oldest;
+} RunningMedian;
+
+static int median_less(const RunningMedian *m, int i, int j) {
+    return m->data[m->heap[i]] < m->data[m->heap[j]];
+}
+
+static int median_exchange(RunningMedian *m, int i, int j) {
+    int t = m->heap[i];
+    m->heap[i] = m->heap[j];
+    m->heap[j] = t;
+    m->pos[m->heap[i]] = i;
+    m->pos[m->heap[j]] = j;
+    return 1;
+}
+
+static int median_compare_exchange(RunningMedian *m, int i, int j) {
+    return median_less(m, i, j) && median_exchange(m, i, j);
+}
+
+static void median_min_sort_down(RunningMedian *m, int i) {
+    int count = (m->size - 1) / 2;
+    for (; i <= count; i *= 2) {
+        if (i > 1 && i < count && median_less(m, i + 1, i)) ++i;
+        if (!median_compare_exchange(m, i, i / 2)) break;
+    }
+}
+
+static void median_max_sort_down(RunningMedian *m, int i) {
+    int count = m->size / 2;
+    for (; i >= -count; i *= 2) {
+        if (i < -1 && i > -count && median_less(m, i, i - 1)) --i;
+        if (!median_compare_exchange(m, i / 2, i)) break;
+    }
+}
+
+// Both return true if the value bubbled all the way up to the median slot
+static int median_min_sort_up(RunningMedian *m, int i) {
+    while (i > 0 && median_compare_exchange(m, i, i / 2)) i /= 2;
+    return i == 0;
+}
+
+static int median_max_sort_up(RunningMedian *m, int i) {
+    while (i < 0 && median_compare_exchange(m, i / 2, i)) i /= 2;
+    return i == 0;
+}
+
+// storage must hold size floats and 2 * size ints
+static void running_median_init(RunningMedian *m, int size, float *values, int *indices, float fill) {
+    m->data = values;
+    m->pos = indices;
+    m->heap = indices + size + size / 2;
+    m->size = size;
+    m->oldest = 0;
+    
+    // Initial layout alternates median, max, min, max, ... which is a valid pair of heaps
+    // when every value is equal.
+    for (int n = size - 1; n >= 0; n--) {
+        m->data[n] = fill;
+        m->pos[n] = ((n + 1) / 2) * ((n & 1) ? -1 : 1);
+        m->heap[m->pos[n]] = n;
+    }
+}
+
+static void running_median_reset(RunningMedian *m, float fill) {
+    running_median_init(m, m->size, m->data, m->pos, fill);
+}
+
+static void running_median_push(RunningMedian *m, float value) {
+    int p = m->pos[m->oldest];
+    float old = m->data[m->oldest];
+    m->data[m->oldest] = value;
+    m->oldest = (m->oldest + 1) % m->size;
+    
+    if (p > 0) {
+        if (old < value) {
+            median_min_sort_down(m, p * 2);
+        } else if (median_min_sort_up(m, p)) {
+            median_max_sort_down(m, -1);
+        }
+    } else if (p < 0) {
+        if (value < old) {
+            median_max_sort_down(m, p * 2);
+        } else if (median_max_sort_up(m, p)) {
+            median_min_sort_down(m, 1);
+        }
+    } else {
+        if (m->size / 2) median_max_sort_down(m, -1);
+        if ((m->size - 1) / 2) median_min_sort_down(m, 1);
+    }
+}
+
+static float running_median_value(const RunningMedian *m) {
+    return m->data[m->heap[0]];
+}
+
+struct HPSSStream {
+    HPSSOptions options;
+    int bin_count;
+    int lookahead;
+    int pushed;
+    int emitted;
+    RunningMedian *time_medians;    // one per bin, window harmonic_kernel frames
+    RunningMedian frequency_median; // reused per frame, window percussive_kernel bins
+    kiss_fft_cpx *delay;            // [(lookahead + 1) * bin_count] frames awaiting output
+    float *percussive_enhanced;     // [(lookahead + 1) * bin_count] frequency-median magnitudes
+    float *magnitude;               // [bin_count]
+    float *median_values;
+    int *median_indices;
+};
+
+HPSSOptions hpss_default_options(void) {
+    HPSSOptions options = {
+        .harmonic_kernel = 17,
+        .percussive_kernel = 17,
+        .mask_power = 2.0f
+    };
+    return options;
+}
+
+HPSSStream* hpss_stream_create(int bin_count, const HPSSOptions *options) {
+    HPSSOptions defaults = hpss_default_options();
+    if (!options) options = &defaults;
+    if (bin_count <= 0 || options->harmonic_kernel <= 0 || options->percussive_kernel <= 0 ||
+        !(options->harmonic_kernel & 1) || !(options->percussive_kernel & 1)) {
+        return NULL;
+    }
+    
+    HPSSStream *stream = (HPSSStream*)calloc(1, sizeof(HPSSStream));
+    if (!stream) return NULL;
+    
+    int time_kernel = options->harmonic_kernel;
+    int frequency_kernel = options->percussive_kernel;
+    stream->options = *options;
+    stream->bin_count = bin_count;
+    stream->lookahead = time_kernel / 2;
+    
+    size_t median_slots = (size_t)bin_count * time_kernel + frequency_kernel;
+    int ring = stream->lookahead + 1;
+    stream->time_medians = (RunningMedian*)malloc(bin_count * sizeof(RunningMedian));
+    stream->median_values = (float*)malloc(median_slots * sizeof(float));
+    stream->median_indices = (int*)malloc(2 * median_slots * sizeof(int));
+    stream->delay = (kiss_fft_cpx*)malloc((size_t)ring * bin_count * sizeof(kiss_fft_cpx));
+    stream->percussive_enhanced = (float*)malloc((size_t)ring * bin_count * sizeof(float));
+    stream->magnitude = (float*)malloc(bin_count * sizeof(float));
+    
+    if (!stream->time_medians || !stream->median_values || !stream->median_indices || !stream->delay ||
+        !stream->percussive_enhanced || !stream->magnitude) {
+        hpss_stream_free(stream);
+        return NULL;
+    }
+    
+    // Frames before the start are treated as silence (zero padding, as in a constant-mode median filter)
+    for (int bin = 0; bin < bin_count; bin++) {
+        running_median_init(&stream->time_medians[bin], time_kernel,
+                            stream->median_values + (size_t)bin * time_kernel,
+                            stream->median_indices + 2 * (size_t)bin * time_kernel, 0.0f);
+        for (int i = 0; i < stream->lookahead; i++) {
+            running_median_push(&stream->time_medians[bin], 0.0f);
+        }
+    }
+    running_median_init(&stream->frequency_median, frequency_kernel,
+                        stream->median_values + (size_t)bin_count * time_kernel,
+                        stream->median_indices + 2 * (size_t)bin_count * time_kernel, 0.0f);
+    
+    return stream;
+}
+
+int hpss_stream_latency(const HPSSStream *stream) {
+    return stream->lookahead;
+}
+
+static void apply_soft_masks(const HPSSStream *stream, const kiss_fft_cpx *frame, const float *percussive_enhanced,
+                             kiss_fft_cpx *harmonic, kiss_fft_cpx *percussive) {
+    float power = stream->options.mask_power;
+    
+    for (int bin = 0; bin < stream->bin_count; bin++) {
+        float h = powf(running_median_value(&stream->time_medians[bin]), power);
+        float p = powf(percussive_enhanced[bin], power);
+        float total = h + p;
+        float mask = total > 0.0f ? h / total : 0.5f;
+        
+        harmonic[bin].r = frame[bin].r * mask;
+        harmonic[bin].i = frame[bin].i * mask;
+        percussive[bin].r = frame[bin].r - harmonic[bin].r;
+        percussive[bin].i = frame[bin].i - harmonic[bin].i;
+    }
+}
+
+int hpss_stream_push(HPSSStream *stream, const kiss_fft_cpx *frame, kiss_fft_cpx *harmonic, kiss_fft_cpx *percussive) {
+    int bin_count = stream->bin_count;
+    int ring = stream->lookahead + 1;
+    int slot = stream->pushed % ring;
+    int half = stream->options.percussive_kernel / 2;
+    kiss_fft_cpx *stored = stream->delay + (size_t)slot * bin_count;
+    float *enhanced = stream->percussive_enhanced + (size_t)slot * bin_count;
+    
+    for (int bin = 0; bin < bin_count; bin++) {
+        stream->magnitude[bin] = sqrtf(frame[bin].r * frame[bin].r + frame[bin].i * frame[bin].i);
+        running_median_push(&stream->time_medians[bin], stream->magnitude[bin]);
+    }
+    memcpy(stored, frame, bin_count * sizeof(kiss_fft_cpx));
+    
+    // Median along frequency, zero-padded at both ends of the spectrum
+    RunningMedian *across = &stream->frequency_median;
+    running_median_reset(across, 0.0f);
+    for (int bin = 0; bin < bin_count + half; bin++) {
+        running_median_push(across, bin < bin_count ? stream->magnitude[bin] : 0.0f);
+        if (bin >= half) enhanced[bin - half] = running_median_value(across);
+    }
+    
+    stream->pushed++;
+    if (stream->pushed <= stream->lookahead) return 0;
+    
+    // The time medians are now centred on the frame lookahead frames back
+    int out_slot = stream->emitted % ring;
+    apply_soft_masks(stream, stream->delay + (size_t)out_slot * bin_count,
+                     stream->percussive_enhanced + (size_t)out_slot * bin_count, harmonic, percussive);
+    stream->emitted++;
+    return 1;
+}
+
+int hpss_stream_flush(HPSSStream *stream, kiss_fft_cpx *harmonic, kiss_fft_cpx *percussive) {
+    if (stream->emitted >= stream->pushed) return 0;
+    
+    int ring = stream->lookahead + 1;
+    int bin_count = stream->bin_count;
+    
+    // Advance the time medians with silence without storing a new frame
+    for (int bin = 0; bin < bin_count; bin++) {
+        running_median_push(&stream->time_medians[bin], 0.0f);
+    }
+    stream->pushed++;
+    
+    int out_slot = stream->emitted % ring;
+    apply_soft_masks(stream, stream->delay + (size_t)out_slot * bin_count,
+                     stream->percussive_enhanced + (size_t)out_slot * bin_count, harmonic, percussive);
+    stream->emitted++;
+    return 1;
+}
+
+void hpss_stream_free(HPSSStream *stream) {
+    if (!stream) return;
+    
+    free(stream->time_medians);
+    free(stream->median_values);
+    free(stream->median_indices);
+    free(stream->delay);
+    free(stream->percussive_enhanced);
+    free(stream->magnitude);
+    free(stream);
+}
+
+HPSSResult* perform_hpss(const float *input_data, int input_length, const STFTParameters *params, const HPSSOptions *options) {
+    HPSSResult *result = (HPSSResult*)calloc(1, sizeof(HPSSResult));
+    if (!result) return NULL;
+    
+    // The median filters walk interleaved frame rows, whatever output the caller asked for
+    STFTParameters frame_params = *params;
+    frame_params.layout = LAYOUT_FRAME_MAJOR;
+    frame_params.format = COMPLEX_INTERLEAVED;
+    STFTResult *spectrogram = perform_stft(input_data, input_length, &frame_params);
+    if (!spectrogram || !spectrogram->success) {
+        result->success = false;
+        result->message = strdup(spectrogram && spectrogram->message ? spectrogram->message : "STFT failed");
+        stft_free_result(spectrogram);
+        return result;
+    }
+    
+    HPSSStream *stream = hpss_stream_create(spectrogram->frequency_bin_count, options);
+    if (!stream) {
+        stft_free_result(spectrogram);
+        result->success = false;
+        result->message = strdup("Invalid HPSS options or out of memory");
+        return result;
+    }
+    
+    // The percussive part is written into a copy; the harmonic part overwrites the
+    // spectrogram in place, which is safe because the stream keeps its own delayed copies.
+    STFTResult percussive = *spectrogram;
+    percussive.message = NULL;
+    percussive.spectrogram_data = (kiss_fft_cpx**)calloc(spectrogram->frame_count, sizeof(kiss_fft_cpx*));
+    bool allocated = percussive.spectrogram_data != NULL;
+    for (int frame = 0; allocated && frame < spectrogram->frame_count; frame++) {
+        percussive.spectrogram_data[frame] = (kiss_fft_cpx*)malloc(spectrogram->frequency_bin_count * sizeof(kiss_fft_cpx));
+        allocated = percussive.spectrogram_data[frame] != NULL;
+    }
+    
+    if (allocated) {
+        int out = 0;
+        for (int frame = 0; frame < spectrogram->frame_count; frame++) {
+            out += hpss_stream_push(stream, spectrogram->spectrogram_data[frame],
+                                    spectrogram->spectrogram_data[out], percussive.spectrogram_data[out]);
+        }
+        while (out < spectrogram->frame_count &&
+               hpss_stream_flush(stream, spectrogram->spectrogram_data[out], percussive.spectrogram_data[out])) {
+            out++;
+        }
+        
+        result->harmonic = perform_istft(spectrogram, params, &result->length);
+        result->percussive = perform_istft(&percussive, params, NULL);
+    }
+    
+    hpss_stream_free(stream);
+    if (percussive.spectrogram_data) {
+        for (int frame = 0; frame < spectrogram->frame_count; frame++) {
+            free(percussive.spectrogram_data[frame]);
+        }
+        free(percussive.spectrogram_data);
+    }
+    stft_free_result(spectrogram);
+    
+    if (!result->harmonic || !result->percussive) {
+        free(result->harmonic);
+        free(result->percussive);
+        result->harmonic = result->percussive = NULL;
+        result->length = 0;
+        result->success = false;
+        result->message = strdup("Failed to allocate HPSS memory");
+        return result;
+    }
+    
+    result->success = true;
+    result->message = strdup("HPSS computation successful");
+    
+    return result;
+}
+
+void hpss_free_result(HPSSResult *result) {
+    if (!result) return;
+    
+    free(result->harmonic);
+    free(result->percussive);
+    free(result->message);
+    free(result);
+}
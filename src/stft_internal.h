@@ -0,0 +1,97 @@
+#ifndef STFT_INTERNAL_H
+#define STFT_INTERNAL_H
+
+#include "../include/stft.h"
+#include "../include/stft_resample.h"
+#include "kiss_fftr.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STFT_ALIGNMENT 64
+#define STFT_HUGE_PAGE_SIZE ((size_t)2 << 20)
+// Bin-major output is staged this many frames at a time, then transposed tile by tile.
+// Frame ranges filled in parallel must start on a multiple of it.
+#define TRANSPOSE_BLOCK_FRAMES 16
+// Largest resample_up / resample_down accepted; the filter grows linearly with it
+#define STFT_MAX_RESAMPLE_FACTOR 4096
+// Widest target_sample_rate / sample_rate (or its inverse) accepted
+#define STFT_MAX_RESAMPLE_RATIO 256.0
+
+// Per-frame analysis state shared by the batch and streaming front ends
+typedef struct {
+    STFTAllocator allocator;
+    int window_size;
+    int bin_count;
+    float gate_energy;          // sum of windowed squares below which the FFT is skipped, < 0 if off
+    float *window;              // premultiplied by the spectrum scale, 16-byte aligned
+    kiss_fftr_cfg real_cfg;     // even window sizes: real FFT on the even/odd packed frame
+    kiss_fft_cfg cfg;           // odd window sizes: complex FFT with zero imaginary parts
+    kiss_fft_cpx *fft_input;    // window_size floats (real_cfg) or window_size bins (cfg)
+    kiss_fft_cpx *fft_input_next;   // second input buffer for the pipelined frame loop
+    kiss_fft_cpx *fft_output;   // holds the scaled spectrum after stft_engine_transform
+    float *split_real;          // COMPLEX_SPLIT only: scaled bins copied out in the scaling loop
+    float *split_imag;
+} STFTFrameEngine;
+
+// Returns NULL on success or an error message the caller must free. allocator may be NULL.
+char* stft_engine_init(STFTFrameEngine *engine, const STFTParameters *params, const STFTAllocator *allocator);
+void stft_engine_destroy(STFTFrameEngine *engine);
+// Windows window_size samples and transforms them into scaled bins 0..bin_count-1.
+// Returns true if the frame fell below the energy gate and its bins were zeroed instead.
+bool stft_engine_transform(STFTFrameEngine *engine, const float *samples);
+// Pool for splitting each FFT (only large sizes use it); NULL keeps them on the calling thread
+struct STFTPool;
+void stft_engine_set_pool(STFTFrameEngine *engine, struct STFTPool *pool);
+
+float stft_window_scale(const STFTParameters *params, const float *window);
+
+void stft_fill_window(WindowType window_type, int window_size, float *window);
+
+// Allocation through an STFTAllocator; NULL or zeroed allocators fall back to malloc/free.
+// Aligned blocks are STFT_ALIGNMENT-aligned and must go back through stft_mem_aligned_free.
+void* stft_mem_alloc(const STFTAllocator *allocator, size_t size);
+void* stft_mem_calloc(const STFTAllocator *allocator, size_t count, size_t size);
+void stft_mem_free(const STFTAllocator *allocator, void *ptr);
+char* stft_mem_strdup(const STFTAllocator *allocator, const char *text);
+void* stft_mem_aligned_alloc(const STFTAllocator *allocator, size_t size);
+void stft_mem_aligned_free(const STFTAllocator *allocator, void *ptr);
+
+// Resampling pre-stage of valid parameters. stft_params_resampler builds a default-quality
+// resampler for their factors or target rate through allocator (NULL for malloc); its filter
+// table comes from the shared per-ratio cache.
+bool stft_resamples(const STFTParameters *params);
+int64_t stft_params_resampled_length(const STFTParameters *params, int input_length);
+STFTResampler* stft_params_resampler(const STFTParameters *params, const STFTAllocator *allocator);
+
+// Allocates a result with storage for every frame of analysis_length samples, already at the
+// analysis rate, and all metadata filled in, or a failed result with a message (including for
+// lengths past INT_MAX). The spectrum itself is left unwritten.
+STFTResult* stft_result_create(const STFTParameters *params, const float *input_data, int64_t analysis_length,
+                               const STFTAllocator *allocator);
+// Computes frames [first_frame, first_frame + frame_count) into result from input_data, which
+// starts at the first sample of first_frame. engine must match params; staging holds
+// TRANSPOSE_BLOCK_FRAMES * bin_count bins and is only used for bin-major output.
+void stft_result_fill(STFTFrameEngine *engine, const STFTParameters *params, STFTResult *result,
+                      const float *input_data, int first_frame, int frame_count, kiss_fft_cpx *staging);
+
+// Frames cut from resampled input are rendered this many at a time into a per-thread buffer of
+// stft_resampled_block_samples floats, in the same pass that windows and transforms them.
+#define RESAMPLE_BLOCK_FRAMES (4 * TRANSPOSE_BLOCK_FRAMES)
+size_t stft_resampled_block_samples(const STFTParameters *params);
+// stft_result_fill for parameters that resample: input_data is the whole input at sample_rate,
+// and only the part frames [first_frame, first_frame + frame_count) reach is converted.
+void stft_result_fill_resampled(STFTFrameEngine *engine, const STFTParameters *params, STFTResult *result,
+                                const STFTResampler *resampler, const float *input_data, int input_length,
+                                int first_frame, int frame_count, kiss_fft_cpx *staging, float *buffer);
+
+// True if the result holds spectrum data in any layout or format
+bool stft_result_has_spectrum(const STFTResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_INTERNAL_H
@@ -0,0 +1,208 @@
+#include "../include/stft.h"
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ACCURACY_FAST kernels. Measured over the full float range:
+//   power dB   |error| < 5e-5 dB   (Cephes logf polynomial, ~1 ulp in ln)
+//   phase      |error| < 2e-6 rad  (degree-11 odd minimax atan on [0, 1])
+//   magnitude  relative error < 3e-7 (rsqrt estimate + one Newton step)
+// Power is floored at 1e-20 like cpx_power_db, so the log never sees zero or subnormals;
+// magnitudes of subnormal power (< 1.1e-19) flush to zero.
+
+#define DB_PER_NEPER 4.3429448190325182f     // 10 / ln(10)
+#define LN2_HI 0.693359375f
+#define LN2_LO -2.12194440e-4f
+#define POWER_FLOOR 1e-20f
+
+#define ATAN_C1 0.99997726f
+#define ATAN_C3 -0.33262347f
+#define ATAN_C5 0.19354346f
+#define ATAN_C7 -0.11643287f
+#define ATAN_C9 0.05265332f
+#define ATAN_C11 -0.01172120f
+
+static const float LOG_POLY[9] = {
+    7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f, -1.2420140846e-1f, 1.4249322787e-1f,
+    -1.6668057665e-1f, 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f
+};
+
+static float fast_power_db(float power) {
+    if (power < POWER_FLOOR) power = POWER_FLOOR;
+    
+    // power = m * 2^e with m in [sqrt(0.5), sqrt(2)) after the fold below
+    uint32_t bits;
+    memcpy(&bits, &power, sizeof(bits));
+    int e = (int)((bits >> 23) & 0xff) - 126;
+    bits = (bits & 0x007fffffu) | 0x3f000000u;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    if (m < 0.70710678f) {
+        m = m + m;
+        e--;
+    }
+    
+    float x = m - 1.0f;
+    float z = x * x;
+    float y = LOG_POLY[0];
+    for (int k = 1; k < 9; k++) {
+        y = y * x + LOG_POLY[k];
+    }
+    y = y * x * z + LN2_LO * e - 0.5f * z;
+    return (x + y + LN2_HI * e) * DB_PER_NEPER;
+}
+
+static float fast_atan2(float y, float x) {
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float hi = ax > ay ? ax : ay;
+    float lo = ax > ay ? ay : ax;
+    float a = hi > 0.0f ? lo / hi : 0.0f;
+    float s = a * a;
+    
+    float r = ((((ATAN_C11 * s + ATAN_C9) * s + ATAN_C7) * s + ATAN_C5) * s + ATAN_C3) * s * a + ATAN_C1 * a;
+    if (ay > ax) r = 1.57079637f - r;
+    if (x < 0.0f) r = 3.14159274f - r;
+    return copysignf(r, y);
+}
+
+static float fast_sqrt(float value) {
+    return value >= FLT_MIN ? sqrtf(value) : 0.0f;
+}
+
+#if defined(__SSE2__)
+static inline __m128 power_vec(const kiss_fft_cpx *bins) {
+    // Deinterleave four complex bins into re/im lanes
+    __m128 a = _mm_loadu_ps(&bins[0].r);
+    __m128 b = _mm_loadu_ps(&bins[2].r);
+    __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+}
+
+static inline __m128 power_db_vec(__m128 power) {
+    power = _mm_max_ps(power, _mm_set1_ps(POWER_FLOOR));
+    
+    __m128i bits = _mm_castps_si128(power);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                             _mm_set1_epi32(0x3f000000)));
+    
+    // m < sqrt(0.5): double it and drop the exponent by one (small lanes are all-ones = -1)
+    __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.70710678f));
+    e = _mm_add_epi32(e, _mm_castps_si128(small));
+    m = _mm_add_ps(m, _mm_and_ps(m, small));
+    __m128 fe = _mm_cvtepi32_ps(e);
+    
+    __m128 x = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(LOG_POLY[0]);
+    for (int k = 1; k < 9; k++) {
+        y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_POLY[k]));
+    }
+    y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+    y = _mm_add_ps(y, _mm_mul_ps(fe, _mm_set1_ps(LN2_LO)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    x = _mm_add_ps(_mm_add_ps(x, y), _mm_mul_ps(fe, _mm_set1_ps(LN2_HI)));
+    return _mm_mul_ps(x, _mm_set1_ps(DB_PER_NEPER));
+}
+
+static inline __m128 sqrt_vec(__m128 value) {
+    // x * rsqrt(x), refined once: r' = r * (1.5 - 0.5 * x * r * r).
+    // rsqrt of zero or a subnormal is Inf, so those lanes are forced to zero.
+    __m128 r = _mm_rsqrt_ps(value);
+    __m128 half_x = _mm_mul_ps(value, _mm_set1_ps(0.5f));
+    r = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_x, _mm_mul_ps(r, r))));
+    __m128 nonzero = _mm_cmpge_ps(value, _mm_set1_ps(FLT_MIN));
+    return _mm_and_ps(_mm_mul_ps(value, r), nonzero);
+}
+
+static inline __m128 atan2_vec(__m128 y, __m128 x) {
+    __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    __m128 ay = _mm_andnot_ps(sign_mask, y);
+    __m128 hi = _mm_max_ps(ax, ay);
+    __m128 lo = _mm_min_ps(ax, ay);
+    __m128 a = _mm_and_ps(_mm_div_ps(lo, hi), _mm_cmpgt_ps(hi, _mm_setzero_ps()));
+    __m128 s = _mm_mul_ps(a, a);
+    
+    __m128 r = _mm_set1_ps(ATAN_C11);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C9));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C7));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(ATAN_C3));
+    r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), _mm_mul_ps(a, _mm_set1_ps(ATAN_C1)));
+    
+    __m128 steep = _mm_cmpgt_ps(ay, ax);
+    r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(1.57079637f), r)), _mm_andnot_ps(steep, r));
+    __m128 left = _mm_cmplt_ps(x, _mm_setzero_ps());
+    r = _mm_or_ps(_mm_and_ps(left, _mm_sub_ps(_mm_set1_ps(3.14159274f), r)), _mm_andnot_ps(left, r));
+    return _mm_or_ps(r, _mm_and_ps(y, sign_mask));
+}
+#endif
+
+void stft_magnitude_row(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output) {
+    int i = 0;
+    if (accuracy == ACCURACY_FAST) {
+#if defined(__SSE2__)
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(output + i, sqrt_vec(power_vec(bins + i)));
+        }
+#endif
+        for (; i < count; i++) {
+            output[i] = fast_sqrt(bins[i].r * bins[i].r + bins[i].i * bins[i].i);
+        }
+        return;
+    }
+    
+    for (; i < count; i++) {
+        output[i] = cpx_magnitude(bins[i]);
+    }
+}
+
+void stft_power_db_row(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output) {
+    int i = 0;
+    if (accuracy == ACCURACY_FAST) {
+#if defined(__SSE2__)
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(output + i, power_db_vec(power_vec(bins + i)));
+        }
+#endif
+        for (; i < count; i++) {
+            output[i] = fast_power_db(bins[i].r * bins[i].r + bins[i].i * bins[i].i);
+        }
+        return;
+    }
+    
+    for (; i < count; i++) {
+        output[i] = cpx_power_db(bins[i]);
+    }
+}
+
+void stft_phase_row(const kiss_fft_cpx *bins, int count, STFTAccuracy accuracy, float *output) {
+    int i = 0;
+    if (accuracy == ACCURACY_FAST) {
+#if defined(__SSE2__)
+        for (; i + 4 <= count; i += 4) {
+            __m128 a = _mm_loadu_ps(&bins[i].r);
+            __m128 b = _mm_loadu_ps(&bins[i + 2].r);
+            __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(output + i, atan2_vec(im, re));
+        }
+#endif
+        for (; i < count; i++) {
+            output[i] = fast_atan2(bins[i].i, bins[i].r);
+        }
+        return;
+    }
+    
+    for (; i < count; i++) {
+        output[i] = cpx_phase(bins[i]);
+    }
+}
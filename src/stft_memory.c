@@ -0,0 +1,89 @@
+#define _GNU_SOURCE
+#include "../include/stft.h"
+#include "stft_internal.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define BLOCK_OFFSET 64         // header space in front of every block, keeps 64-byte alignment
+
+// Sits just below every returned pointer
+typedef struct {
+    void *base;
+    size_t mapped;              // mmap length, 0 for malloc blocks
+} HugeBlockHeader;
+
+#if defined(__linux__)
+// Maps length bytes starting on a huge page boundary, so THP can back the whole range
+static void* map_huge_aligned(size_t length) {
+    void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) return base;
+    
+    // No reserved hugetlbfs pages: map with slack, trim to alignment and ask for THP
+    size_t padded = length + STFT_HUGE_PAGE_SIZE;
+    unsigned char *raw = (unsigned char*)mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    
+    unsigned char *aligned = (unsigned char*)(((uintptr_t)raw + STFT_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(STFT_HUGE_PAGE_SIZE - 1));
+    if (aligned > raw) munmap(raw, aligned - raw);
+    if (aligned + length < raw + padded) munmap(aligned + length, raw + padded - (aligned + length));
+    madvise(aligned, length, MADV_HUGEPAGE);
+    return aligned;
+}
+#endif
+
+static void* huge_page_aligned_alloc(void *ctx, size_t size, size_t alignment) {
+    (void)ctx;
+    size_t offset = alignment > BLOCK_OFFSET ? alignment : BLOCK_OFFSET;
+    
+#if defined(__linux__)
+    // Pages are only reserved here; they are faulted in (and placed on a NUMA node) by first touch
+    if (size >= STFT_HUGE_PAGE_SIZE / 2) {
+        size_t mapped = (size + offset + STFT_HUGE_PAGE_SIZE - 1) & ~(STFT_HUGE_PAGE_SIZE - 1);
+        unsigned char *base = (unsigned char*)map_huge_aligned(mapped);
+        if (base) {
+            HugeBlockHeader *header = (HugeBlockHeader*)(base + offset) - 1;
+            header->base = base;
+            header->mapped = mapped;
+            return base + offset;
+        }
+    }
+#endif
+    
+    size_t align = alignment > 16 ? alignment : 16;
+    unsigned char *raw = (unsigned char*)malloc(size + offset + align);
+    if (!raw) return NULL;
+    
+    unsigned char *block = (unsigned char*)(((uintptr_t)raw + offset + align - 1) & ~(uintptr_t)(align - 1));
+    HugeBlockHeader *header = (HugeBlockHeader*)block - 1;
+    header->base = raw;
+    header->mapped = 0;
+    return block;
+}
+
+static void* huge_page_alloc(void *ctx, size_t size) {
+    return huge_page_aligned_alloc(ctx, size, BLOCK_OFFSET);
+}
+
+static void huge_page_free(void *ctx, void *ptr) {
+    (void)ctx;
+    if (!ptr) return;
+    
+    HugeBlockHeader *header = (HugeBlockHeader*)ptr - 1;
+#if defined(__linux__)
+    if (header->mapped) {
+        munmap(header->base, header->mapped);
+        return;
+    }
+#endif
+    free(header->base);
+}
+
+static const STFTAllocator huge_page_allocator = { huge_page_alloc, huge_page_free, huge_page_aligned_alloc, NULL };
+
+const STFTAllocator* stft_huge_page_allocator(void) {
+    return &huge_page_allocator;
+}
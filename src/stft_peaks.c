@@ -0,0 +1,213 @@
+#define _XOPEN_SOURCE 700
+#include "../include/stft_peaks.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Min-heap of bin indices keyed by power: the root is the weakest peak kept so far,
+// so each new local maximum costs O(log K) and the frame is never sorted.
+static void heap_sift_down(int *heap, int size, const float *power, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && power[heap[left]] < power[heap[smallest]]) smallest = left;
+        if (right < size && power[heap[right]] < power[heap[smallest]]) smallest = right;
+        if (smallest == i) return;
+        
+        int tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void heap_offer(int *heap, int *size, int capacity, const float *power, int bin) {
+    if (*size < capacity) {
+        int i = (*size)++;
+        heap[i] = bin;
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (power[heap[parent]] <= power[heap[i]]) break;
+            int tmp = heap[i];
+            heap[i] = heap[parent];
+            heap[parent] = tmp;
+            i = parent;
+        }
+    } else if (power[bin] > power[heap[0]]) {
+        heap[0] = bin;
+        heap_sift_down(heap, *size, power, 0);
+    }
+}
+
+static float wrap_phase(float phase) {
+    while (phase > (float)M_PI) phase -= 2.0f * (float)M_PI;
+    while (phase < -(float)M_PI) phase += 2.0f * (float)M_PI;
+    return phase;
+}
+
+static SpectralPeak interpolate_peak(const kiss_fft_cpx *bins, const float *power, int bin, double frequency_resolution) {
+    // Half the natural log of power is the log magnitude
+    float left = 0.5f * logf(fmaxf(power[bin - 1], 1e-30f));
+    float centre = 0.5f * logf(fmaxf(power[bin], 1e-30f));
+    float right = 0.5f * logf(fmaxf(power[bin + 1], 1e-30f));
+    
+    float denominator = left - 2.0f * centre + right;
+    float offset = denominator < 0.0f ? 0.5f * (left - right) / denominator : 0.0f;
+    
+    SpectralPeak peak;
+    peak.frequency = (float)((bin + offset) * frequency_resolution);
+    peak.amplitude = expf(centre - 0.25f * (left - right) * offset);
+    
+    float phase = atan2f(bins[bin].i, bins[bin].r);
+    int neighbour = offset >= 0.0f ? bin + 1 : bin - 1;
+    float neighbour_phase = atan2f(bins[neighbour].i, bins[neighbour].r);
+    peak.phase = wrap_phase(phase + fabsf(offset) * wrap_phase(neighbour_phase - phase));
+    
+    return peak;
+}
+
+int stft_find_peaks(const kiss_fft_cpx *bins, int bin_count, double frequency_resolution, float min_db,
+                    int max_peaks, SpectralPeak *peaks, float *scratch, int *heap) {
+    if (bin_count < 3 || max_peaks <= 0) return 0;
+    
+    float *power = scratch;
+    for (int bin = 0; bin < bin_count; bin++) {
+        power[bin] = bins[bin].r * bins[bin].r + bins[bin].i * bins[bin].i;
+    }
+    
+    float floor_power = powf(10.0f, min_db / 10.0f);
+    int heap_size = 0;
+    int bin = 1;
+    
+#if defined(__SSE2__)
+    // Four local-maximum tests per iteration; the movemask drives the (rare) heap inserts.
+    __m128 floor_vec = _mm_set1_ps(floor_power);
+    for (; bin + 4 < bin_count; bin += 4) {
+        __m128 centre = _mm_loadu_ps(power + bin);
+        __m128 left = _mm_loadu_ps(power + bin - 1);
+        __m128 right = _mm_loadu_ps(power + bin + 1);
+        __m128 is_peak = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(centre, left), _mm_cmpge_ps(centre, right)),
+                                    _mm_cmpgt_ps(centre, floor_vec));
+        int mask = _mm_movemask_ps(is_peak);
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            heap_offer(heap, &heap_size, max_peaks, power, bin + lane);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    
+    for (; bin < bin_count - 1; bin++) {
+        if (power[bin] > power[bin - 1] && power[bin] >= power[bin + 1] && power[bin] > floor_power) {
+            heap_offer(heap, &heap_size, max_peaks, power, bin);
+        }
+    }
+    
+    // Drain the heap weakest-first into the back of the output so it ends up strongest first
+    int count = heap_size;
+    for (int k = count - 1; k >= 0; k--) {
+        int weakest = heap[0];
+        heap[0] = heap[--heap_size];
+        heap_sift_down(heap, heap_size, power, 0);
+        peaks[k] = interpolate_peak(bins, power, weakest, frequency_resolution);
+    }
+    
+    return count;
+}
+
+typedef struct {
+    PeakResult *result;
+    double frequency_resolution;
+    float min_db;
+    float *scratch;
+    int *heap;
+} PeakPass;
+
+static void extract_frame_peaks(const STFTFrame *frame, void *user_data) {
+    PeakPass *pass = (PeakPass*)user_data;
+    PeakResult *result = pass->result;
+    
+    result->peak_count[frame->index] = stft_find_peaks(frame->bins, frame->bin_count, pass->frequency_resolution,
+                                                       pass->min_db, result->max_peaks,
+                                                       result->peaks + (size_t)frame->index * result->max_peaks,
+                                                       pass->scratch, pass->heap);
+}
+
+PeakResult* perform_stft_peaks(const float *input_data, int input_length, const STFTParameters *params, int max_peaks, float min_db) {
+    PeakResult *result = (PeakResult*)calloc(1, sizeof(PeakResult));
+    if (!result) return NULL;
+    
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) {
+        result->success = false;
+        result->message = validation_error;
+        return result;
+    }
+    
+    if (max_peaks <= 0) {
+        result->success = false;
+        result->message = strdup("Peak count must be greater than 0");
+        return result;
+    }
+    
+    int frame_count = stft_get_frame_count(params, input_length);
+    int frequency_bin_count = params->window_size / 2 + 1;
+    
+    PeakPass pass;
+    pass.result = result;
+    pass.frequency_resolution = stft_get_frequency_resolution(params);
+    pass.min_db = min_db;
+    pass.scratch = (float*)malloc(frequency_bin_count * sizeof(float));
+    pass.heap = (int*)malloc(max_peaks * sizeof(int));
+    result->max_peaks = max_peaks;
+    if (frame_count > 0) {
+        result->peaks = (SpectralPeak*)malloc((size_t)frame_count * max_peaks * sizeof(SpectralPeak));
+        result->peak_count = (int*)malloc(frame_count * sizeof(int));
+    }
+    
+    if (!pass.scratch || !pass.heap || (frame_count > 0 && (!result->peaks || !result->peak_count))) {
+        free(pass.scratch);
+        free(pass.heap);
+        free(result->peaks);
+        free(result->peak_count);
+        result->peaks = NULL;
+        result->peak_count = NULL;
+        result->success = false;
+        result->message = strdup("Failed to allocate peak memory");
+        return result;
+    }
+    
+    char *error = stft_process_frames(input_data, input_length, params, extract_frame_peaks, &pass);
+    free(pass.scratch);
+    free(pass.heap);
+    
+    if (error) {
+        free(result->peaks);
+        free(result->peak_count);
+        result->peaks = NULL;
+        result->peak_count = NULL;
+        result->success = false;
+        result->message = error;
+        return result;
+    }
+    
+    result->success = true;
+    result->frame_count = frame_count;
+    result->frame_time = stft_get_frame_time(params);
+    result->message = strdup("Peak extraction successful");
+    
+    return result;
+}
+
+void peaks_free_result(PeakResult *result) {
+    if (!result) return;
+    
+    free(result->peaks);
+    free(result->peak_count);
+    free(result->message);
+    free(result);
+}
@@ -0,0 +1,361 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stft_pitch.h"
+#include "kiss_fftr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+    float lag[PITCH_MAX_CANDIDATES];
+    float difference[PITCH_MAX_CANDIDATES];
+    float cost[PITCH_MAX_CANDIDATES];
+    int count;
+    float best_cost;
+} PitchCandidates;
+
+typedef struct {
+    kiss_fftr_cfg forward;
+    kiss_fftr_cfg inverse;
+    int nfft;
+    int min_lag;
+    int max_lag;
+    int integration_length;
+    float *time_buffer;         // nfft
+    kiss_fft_cpx *head_spectrum;    // nfft/2+1
+    kiss_fft_cpx *frame_spectrum;   // nfft/2+1
+    double *energy_prefix;      // window_size+1
+    float *difference;          // max_lag+2, cumulative-mean normalized
+} YinState;
+
+PitchOptions pitch_default_options(void) {
+    PitchOptions options = {
+        .min_frequency = 60.0,
+        .max_frequency = 800.0,
+        .threshold = 0.1,
+        .viterbi = false,
+        .octave_cost = 0.5,
+        .voicing_cost = 0.1
+    };
+    return options;
+}
+
+static void yin_state_free(YinState *state) {
+    kiss_fftr_free(state->forward);
+    kiss_fftr_free(state->inverse);
+    free(state->time_buffer);
+    free(state->head_spectrum);
+    free(state->frame_spectrum);
+    free(state->energy_prefix);
+    free(state->difference);
+}
+
+static int yin_state_init(YinState *state, int window_size, int min_lag, int max_lag) {
+    memset(state, 0, sizeof(YinState));
+    
+    // The correlation only needs lags 0..max_lag of a head of length window_size - max_lag,
+    // which never wraps for a circular transform of window_size points.
+    state->nfft = kiss_fftr_next_fast_size_real(window_size);
+    state->min_lag = min_lag;
+    state->max_lag = max_lag;
+    state->integration_length = window_size - max_lag;
+    
+    int spectrum_size = state->nfft / 2 + 1;
+    state->forward = kiss_fftr_alloc(state->nfft, 0, NULL, NULL);
+    state->inverse = kiss_fftr_alloc(state->nfft, 1, NULL, NULL);
+    state->time_buffer = (float*)malloc(state->nfft * sizeof(float));
+    state->head_spectrum = (kiss_fft_cpx*)malloc(spectrum_size * sizeof(kiss_fft_cpx));
+    state->frame_spectrum = (kiss_fft_cpx*)malloc(spectrum_size * sizeof(kiss_fft_cpx));
+    state->energy_prefix = (double*)malloc((window_size + 1) * sizeof(double));
+    state->difference = (float*)malloc((max_lag + 2) * sizeof(float));
+    
+    if (!state->forward || !state->inverse || !state->time_buffer || !state->head_spectrum ||
+        !state->frame_spectrum || !state->energy_prefix || !state->difference) {
+        yin_state_free(state);
+        return 0;
+    }
+    return 1;
+}
+
+// Fills state->difference with the cumulative-mean normalized difference d'(tau), tau = 0..max_lag.
+static void yin_difference(YinState *state, const float *frame, int window_size) {
+    int nfft = state->nfft;
+    int spectrum_size = nfft / 2 + 1;
+    int length = state->integration_length;
+    
+    memset(state->time_buffer, 0, nfft * sizeof(float));
+    memcpy(state->time_buffer, frame, length * sizeof(float));
+    kiss_fftr(state->forward, state->time_buffer, state->head_spectrum);
+    
+    memcpy(state->time_buffer, frame, window_size * sizeof(float));
+    kiss_fftr(state->forward, state->time_buffer, state->frame_spectrum);
+    
+    // conj(Head) * Frame is the cross-correlation r(tau) = sum_j x[j] * x[j + tau]
+    for (int k = 0; k < spectrum_size; k++) {
+        kiss_fft_cpx a = state->head_spectrum[k];
+        kiss_fft_cpx b = state->frame_spectrum[k];
+        state->frame_spectrum[k].r = a.r * b.r + a.i * b.i;
+        state->frame_spectrum[k].i = a.r * b.i - a.i * b.r;
+    }
+    kiss_fftri(state->inverse, state->frame_spectrum, state->time_buffer);
+    
+    state->energy_prefix[0] = 0.0;
+    for (int i = 0; i < window_size; i++) {
+        state->energy_prefix[i + 1] = state->energy_prefix[i] + (double)frame[i] * frame[i];
+    }
+    
+    double head_energy = state->energy_prefix[length];
+    double running_sum = 0.0;
+    state->difference[0] = 1.0f;
+    for (int tau = 1; tau <= state->max_lag; tau++) {
+        double shifted_energy = state->energy_prefix[tau + length] - state->energy_prefix[tau];
+        double correlation = state->time_buffer[tau] / nfft;
+        double d = head_energy + shifted_energy - 2.0 * correlation;
+        if (d < 0.0) d = 0.0;
+        running_sum += d;
+        state->difference[tau] = running_sum > 0.0 ? (float)(d * tau / running_sum) : 1.0f;
+    }
+    state->difference[state->max_lag + 1] = state->difference[state->max_lag];
+}
+
+static float parabolic_lag(const float *d, int tau) {
+    float left = d[tau - 1];
+    float centre = d[tau];
+    float right = d[tau + 1];
+    float denominator = left - 2.0f * centre + right;
+    if (denominator <= 0.0f) return (float)tau;
+    
+    float shift = 0.5f * (left - right) / denominator;
+    if (shift > 0.5f) shift = 0.5f;
+    if (shift < -0.5f) shift = -0.5f;
+    return tau + shift;
+}
+
+// Classic YIN choice: first dip below threshold, followed down to its local minimum.
+static int yin_pick_lag(const YinState *state, double threshold) {
+    const float *d = state->difference;
+    int best = state->min_lag;
+    
+    for (int tau = state->min_lag; tau <= state->max_lag; tau++) {
+        if (d[tau] < threshold) {
+            while (tau + 1 <= state->max_lag && d[tau + 1] < d[tau]) tau++;
+            return tau;
+        }
+        if (d[tau] < d[best]) best = tau;
+    }
+    return best;
+}
+
+static void yin_collect_candidates(const YinState *state, double threshold, PitchCandidates *candidates) {
+    const float *d = state->difference;
+    candidates->count = 0;
+    candidates->best_cost = 1.0f;
+    
+    for (int tau = state->min_lag; tau <= state->max_lag; tau++) {
+        if (d[tau] > d[tau - 1] || d[tau] > d[tau + 1]) continue;
+        
+        if (d[tau] < candidates->best_cost) candidates->best_cost = d[tau];
+        
+        // A pure periodic signal dips equally at every multiple of its period; like YIN's
+        // first-dip rule, bias the tie toward the shortest lag.
+        float cost = d[tau] + (float)(threshold * tau / state->max_lag);
+        
+        // Keep the PITCH_MAX_CANDIDATES deepest minima, replacing the shallowest one
+        int slot = candidates->count;
+        if (slot == PITCH_MAX_CANDIDATES) {
+            slot = 0;
+            for (int c = 1; c < PITCH_MAX_CANDIDATES; c++) {
+                if (candidates->cost[c] > candidates->cost[slot]) slot = c;
+            }
+            if (candidates->cost[slot] <= cost) continue;
+        } else {
+            candidates->count++;
+        }
+        candidates->lag[slot] = parabolic_lag(d, tau);
+        candidates->difference[slot] = d[tau];
+        candidates->cost[slot] = cost;
+    }
+}
+
+// Viterbi over the per-frame candidates plus one unvoiced state (index count).
+static int viterbi_smooth(const PitchCandidates *candidates, int frame_count, const STFTParameters *params,
+                          const PitchOptions *options, float *frequency, float *periodicity) {
+    const int states = PITCH_MAX_CANDIDATES + 1;
+    float *score = (float*)malloc((size_t)frame_count * states * sizeof(float));
+    int *back = (int*)malloc((size_t)frame_count * states * sizeof(int));
+    if (!score || !back) {
+        free(score);
+        free(back);
+        return 0;
+    }
+    
+    for (int frame = 0; frame < frame_count; frame++) {
+        const PitchCandidates *current = &candidates[frame];
+        const PitchCandidates *previous = frame > 0 ? &candidates[frame - 1] : NULL;
+        float unvoiced_cost = (float)fmax(0.0, 2.0 * options->threshold - current->best_cost);
+        
+        for (int s = 0; s <= current->count; s++) {
+            bool voiced = s < current->count;
+            float observation = voiced ? current->cost[s] : unvoiced_cost;
+            float best = INFINITY;
+            int best_previous = 0;
+            
+            if (!previous) {
+                best = 0.0f;
+            } else {
+                for (int p = 0; p <= previous->count; p++) {
+                    bool previous_voiced = p < previous->count;
+                    float transition;
+                    if (voiced && previous_voiced) {
+                        transition = (float)(options->octave_cost * fabs(log2(previous->lag[p] / current->lag[s])));
+                    } else if (voiced != previous_voiced) {
+                        transition = (float)options->voicing_cost;
+                    } else {
+                        transition = 0.0f;
+                    }
+                    float total = score[(size_t)(frame - 1) * states + p] + transition;
+                    if (total < best) {
+                        best = total;
+                        best_previous = p;
+                    }
+                }
+            }
+            score[(size_t)frame * states + s] = best + observation;
+            back[(size_t)frame * states + s] = best_previous;
+        }
+    }
+    
+    const PitchCandidates *last = &candidates[frame_count - 1];
+    int state = 0;
+    for (int s = 1; s <= last->count; s++) {
+        if (score[(size_t)(frame_count - 1) * states + s] < score[(size_t)(frame_count - 1) * states + state]) state = s;
+    }
+    
+    for (int frame = frame_count - 1; frame >= 0; frame--) {
+        const PitchCandidates *current = &candidates[frame];
+        if (state < current->count) {
+            frequency[frame] = (float)(params->sample_rate / current->lag[state]);
+            periodicity[frame] = 1.0f - current->difference[state];
+        } else {
+            frequency[frame] = 0.0f;
+            periodicity[frame] = 1.0f - current->best_cost;
+        }
+        state = back[(size_t)frame * states + state];
+    }
+    
+    free(score);
+    free(back);
+    return 1;
+}
+
+PitchResult* perform_pitch_tracking(const float *input_data, int input_length, const STFTParameters *params, const PitchOptions *options) {
+    PitchResult *result = (PitchResult*)calloc(1, sizeof(PitchResult));
+    if (!result) return NULL;
+    
+    PitchOptions defaults = pitch_default_options();
+    if (!options) options = &defaults;
+    
+    char *validation_error = stft_validate_parameters(params);
+    if (validation_error) {
+        result->success = false;
+        result->message = validation_error;
+        return result;
+    }
+    
+    if (!input_data || input_length < params->window_size) {
+        result->success = false;
+        result->message = strdup("Input data too short for window size");
+        return result;
+    }
+    
+    if (options->min_frequency <= 0 || options->max_frequency <= options->min_frequency) {
+        result->success = false;
+        result->message = strdup("Pitch range must satisfy 0 < min_frequency < max_frequency");
+        return result;
+    }
+    
+    int window_size = params->window_size;
+    int min_lag = (int)floor(params->sample_rate / options->max_frequency);
+    int max_lag = (int)ceil(params->sample_rate / options->min_frequency);
+    if (min_lag < 2) min_lag = 2;
+    if (max_lag > window_size / 2) max_lag = window_size / 2;
+    if (max_lag <= min_lag) {
+        result->success = false;
+        result->message = strdup("Window size too short for the requested pitch range");
+        return result;
+    }
+    
+    YinState state;
+    if (!yin_state_init(&state, window_size, min_lag, max_lag)) {
+        result->success = false;
+        result->message = strdup("Failed to allocate pitch tracker buffers");
+        return result;
+    }
+    
+    // YIN works on the raw signal, so frames follow the input rate even if params resample
+    int frame_count = (input_length - window_size) / params->hop_size + 1;
+    result->frequency = (float*)malloc(frame_count * sizeof(float));
+    result->periodicity = (float*)malloc(frame_count * sizeof(float));
+    PitchCandidates *candidates = NULL;
+    if (options->viterbi) {
+        candidates = (PitchCandidates*)malloc(frame_count * sizeof(PitchCandidates));
+    }
+    
+    if (!result->frequency || !result->periodicity || (options->viterbi && !candidates)) {
+        yin_state_free(&state);
+        free(candidates);
+        free(result->frequency);
+        free(result->periodicity);
+        result->frequency = result->periodicity = NULL;
+        result->success = false;
+        result->message = strdup("Failed to allocate pitch track memory");
+        return result;
+    }
+    
+    for (int frame = 0; frame < frame_count; frame++) {
+        yin_difference(&state, input_data + (size_t)frame * params->hop_size, window_size);
+        
+        if (candidates) {
+            yin_collect_candidates(&state, options->threshold, &candidates[frame]);
+            continue;
+        }
+        
+        int tau = yin_pick_lag(&state, options->threshold);
+        float d = state.difference[tau];
+        result->periodicity[frame] = 1.0f - d;
+        result->frequency[frame] = d < options->threshold
+            ? (float)(params->sample_rate / parabolic_lag(state.difference, tau))
+            : 0.0f;
+    }
+    
+    yin_state_free(&state);
+    
+    if (candidates) {
+        int smoothed = viterbi_smooth(candidates, frame_count, params, options, result->frequency, result->periodicity);
+        free(candidates);
+        if (!smoothed) {
+            free(result->frequency);
+            free(result->periodicity);
+            result->frequency = result->periodicity = NULL;
+            result->success = false;
+            result->message = strdup("Failed to allocate Viterbi memory");
+            return result;
+        }
+    }
+    
+    result->success = true;
+    result->frame_count = frame_count;
+    // YIN runs at the input rate even when the STFT parameters resample
+    result->frame_time = (double)params->hop_size / params->sample_rate;
+    result->message = strdup("Pitch tracking successful");
+    
+    return result;
+}
+
+void pitch_free_result(PitchResult *result) {
+    if (!result) return;
+    
+    free(result->frequency);
+    free(result->periodicity);
+    free(result->message);
+    free(result);
+}
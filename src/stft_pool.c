@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+#include "stft_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each worker owns a deque of task indices, stored as one packed [lo, hi) range so both ends
+// move with a single CAS: the owner pops from lo, thieves take the upper half from hi.
+// Indices are handed out exactly once per job, so a stale range can never reappear (no ABA).
+typedef struct {
+    uint64_t range;
+    char pad[56];               // one deque per cache line
+} TaskDeque;
+
+struct STFTPool {
+    int size;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    bool shutdown;
+    bool pin_threads;
+    
+    // Current job, published under lock by bumping generation
+    unsigned generation;
+    STFTPoolTask task;
+    void *arg;
+    TaskDeque *deques;          // [size], seeded with an even split of the tasks
+    int active;                 // workers that joined the current job and have not left it
+    int claimed;                // set by stft_pool_try_run while it owns the pool
+};
+
+typedef struct {
+    STFTPool *pool;
+    int worker;
+} WorkerStart;
+
+static uint64_t pack_range(uint32_t lo, uint32_t hi) {
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static bool pop_front(TaskDeque *deque, int *index) {
+    uint64_t range = __atomic_load_n(&deque->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t lo = (uint32_t)range;
+        uint32_t hi = (uint32_t)(range >> 32);
+        if (lo >= hi) return false;
+        if (__atomic_compare_exchange_n(&deque->range, &range, pack_range(lo + 1, hi), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *index = (int)lo;
+            return true;
+        }
+    }
+}
+
+// Takes the upper half (rounded up) of a victim's range
+static bool steal_back(TaskDeque *victim, uint32_t *stolen_lo, uint32_t *stolen_hi) {
+    uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t lo = (uint32_t)range;
+        uint32_t hi = (uint32_t)(range >> 32);
+        if (lo >= hi) return false;
+        uint32_t mid = hi - (hi - lo + 1) / 2;
+        if (__atomic_compare_exchange_n(&victim->range, &range, pack_range(lo, mid), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *stolen_lo = mid;
+            *stolen_hi = hi;
+            return true;
+        }
+    }
+}
+
+// Drains the worker's own deque, then refills it from other workers until a full sweep finds
+// nothing. The caller runs this too, so it helps with the job instead of blocking on it.
+static void run_tasks(STFTPool *pool, STFTPoolTask task, void *arg, int worker) {
+    TaskDeque *own = &pool->deques[worker];
+    for (;;) {
+        int index;
+        while (pop_front(own, &index)) {
+            task(arg, index, worker);
+        }
+    
+        bool stole = false;
+        for (int step = 1; step < pool->size && !stole; step++) {
+            uint32_t lo, hi;
+            if (steal_back(&pool->deques[(worker + step) % pool->size], &lo, &hi)) {
+                // Our deque is empty, so no thief can touch it until this store publishes the range
+                __atomic_store_n(&own->range, pack_range(lo, hi), __ATOMIC_RELEASE);
+                stole = true;
+            }
+        }
+        if (!stole) return;
+    }
+}
+
+static void pin_to_cpu(int worker) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    
+    int count = CPU_COUNT(&allowed);
+    if (count <= 1) return;
+    
+    int wanted = worker % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (wanted-- == 0) {
+            cpu_set_t single;
+            CPU_ZERO(&single);
+            CPU_SET(cpu, &single);
+            pthread_setaffinity_np(pthread_self(), sizeof(single), &single);
+            return;
+        }
+    }
+#else
+    (void)worker;
+#endif
+}
+
+static void* worker_main(void *arg) {
+    WorkerStart start = *(WorkerStart*)arg;
+    free(arg);
+    STFTPool *pool = start.pool;
+    if (pool->pin_threads) pin_to_cpu(start.worker);
+    
+    pthread_mutex_lock(&pool->lock);
+    unsigned seen = pool->generation;
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->shutdown) break;
+    
+        seen = pool->generation;
+        STFTPoolTask task = pool->task;
+        void *task_arg = pool->arg;
+        pool->active++;
+        pthread_mutex_unlock(&pool->lock);
+    
+        run_tasks(pool, task, task_arg, start.worker);
+    
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+STFTPool* stft_pool_create(int size, bool pin_threads) {
+    if (size < 1) size = 1;
+    
+    STFTPool *pool = (STFTPool*)calloc(1, sizeof(STFTPool));
+    if (!pool) return NULL;
+    
+    pool->threads = (pthread_t*)calloc(size, sizeof(pthread_t));
+    if (!pool->threads || posix_memalign((void**)&pool->deques, sizeof(TaskDeque), size * sizeof(TaskDeque)) != 0) {
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    memset(pool->deques, 0, size * sizeof(TaskDeque));
+    
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->pin_threads = pin_threads;
+    pool->size = 1;
+    
+    for (int worker = 1; worker < size; worker++) {
+        WorkerStart *start = (WorkerStart*)malloc(sizeof(WorkerStart));
+        if (!start) break;
+        start->pool = pool;
+        start->worker = worker;
+        if (pthread_create(&pool->threads[worker], NULL, worker_main, start) != 0) {
+            free(start);
+            break;
+        }
+        pool->size++;
+    }
+    
+    // A short pool is still usable; the caller only loses parallelism
+    return pool;
+}
+
+void stft_pool_destroy(STFTPool *pool) {
+    if (!pool) return;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (int worker = 1; worker < pool->size; worker++) {
+        pthread_join(pool->threads[worker], NULL);
+    }
+    
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+int stft_pool_default_size(void) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0) {
+        return CPU_COUNT(&allowed);
+    }
+#endif
+    return 1;
+}
+
+int stft_pool_size(const STFTPool *pool) {
+    return pool ? pool->size : 1;
+}
+
+void stft_pool_run(STFTPool *pool, int task_count, STFTPoolTask task, void *arg) {
+    if (task_count <= 0) return;
+    if (!pool || pool->size == 1 || task_count == 1) {
+        for (int i = 0; i < task_count; i++) {
+            task(arg, i, 0);
+        }
+        return;
+    }
+    
+    pthread_mutex_lock(&pool->lock);
+    // A worker that woke late for the previous job may still be leaving it
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->task = task;
+    pool->arg = arg;
+    // Contiguous seed ranges keep neighbouring tasks on one worker until stealing starts
+    for (int worker = 0; worker < pool->size; worker++) {
+        uint32_t lo = (uint32_t)((int64_t)task_count * worker / pool->size);
+        uint32_t hi = (uint32_t)((int64_t)task_count * (worker + 1) / pool->size);
+        pool->deques[worker].range = pack_range(lo, hi);
+    }
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    
+    run_tasks(pool, task, arg, 0);
+    
+    // Every task is claimed; wait for the workers still running one
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+bool stft_pool_try_run(STFTPool *pool, int task_count, STFTPoolTask task, void *arg) {
+    if (!pool) return false;
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&pool->claimed, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    stft_pool_run(pool, task_count, task, arg);
+    __atomic_store_n(&pool->claimed, 0, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef STFT_POOL_H
+#define STFT_POOL_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Persistent worker threads. The thread calling stft_pool_run takes part as worker 0,
+// so a pool of size N starts N - 1 threads.
+typedef struct STFTPool STFTPool;
+
+typedef void (*STFTPoolTask)(void *arg, int task_index, int worker);
+
+// pin_threads binds worker w to the w-th CPU of the process affinity mask, so a worker and
+// the pages it first touches stay on one NUMA node
+STFTPool* stft_pool_create(int size, bool pin_threads);
+void stft_pool_destroy(STFTPool *pool);
+int stft_pool_size(const STFTPool *pool);
+// CPUs in the process affinity mask, at least 1
+int stft_pool_default_size(void);
+
+// Runs task(arg, i, worker) for every i in [0, task_count) and returns when all have finished.
+// Tasks start evenly split across per-worker deques; idle workers steal half of another
+// worker's remaining range, so uneven task costs do not leave a straggler tail.
+void stft_pool_run(STFTPool *pool, int task_count, STFTPoolTask task, void *arg);
+
+// stft_pool_run for a pool other threads may also be using: returns false without running
+// anything if the pool is busy, so the caller can run the tasks itself.
+bool stft_pool_try_run(STFTPool *pool, int task_count, STFTPoolTask task, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STFT_POOL_H
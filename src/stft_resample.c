@@ -0,0 +1,515 @@
+#define _XOPEN_SOURCE 700
+#include "../include/stft_resample.h"
+#include "stft_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Input samples appended per pass; the filter history rides in front of them
+#define RESAMPLE_CHUNK 4096
+// Ratios with no exact factors up to STFT_MAX_RESAMPLE_FACTOR use 2^RESAMPLE_PHASE_BITS filter
+// phases per input sample and interpolate between neighbours; time is kept in 2^-32 samples
+#define RESAMPLE_PHASE_BITS 8
+#define RESAMPLE_FRACTION_BITS 32
+
+// Output timing: output k is centred on input time k * step / denominator
+typedef struct {
+    uint64_t denominator;       // time units per input sample: up for exact ratios, else 2^32
+    uint64_t step;              // input time per output, in those units
+    bool interpolate;
+} ResampleTiming;
+
+// Filter phases for one ratio and quality, built once and shared by every resampler using them
+typedef struct ResampleTable {
+    struct ResampleTable *next;
+    int references;
+    ResampleTiming timing;
+    ResampleOptions options;
+    int phase_shift;            // time fraction >> phase_shift is the phase
+    int taps;                   // per phase, a multiple of 4
+    int start_position;         // newest input sample and time fraction under output 0
+    uint64_t start_fraction;
+    float *coeffs;              // [phase * taps + j], reversed so each output reads its input forwards
+} ResampleTable;
+
+struct STFTResampler {
+    STFTAllocator allocator;
+    ResampleTable *table;
+    uint64_t step_whole;        // timing.step split into whole samples and a fraction
+    uint64_t step_fraction;
+    float *buffer;              // taps - 1 history samples followed by up to RESAMPLE_CHUNK new ones
+    int capacity;
+    int fill;
+    int position;               // buffer index of the newest input sample under the next output
+    uint64_t fraction;          // time fraction of the next output, in [0, denominator)
+};
+
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+static ResampleTable *table_cache;
+
+ResampleOptions resample_default_options(void) {
+    ResampleOptions options = {
+        .zero_crossings = 16,
+        .cutoff = 0.9,
+        .kaiser_beta = 8.0
+    };
+    return options;
+}
+
+static bool valid_options(const ResampleOptions *options) {
+    return options->zero_crossings >= 1 && options->zero_crossings <= 256 &&
+           options->cutoff > 0.0 && options->cutoff <= 1.0 && options->kaiser_beta >= 0.0;
+}
+
+static int greatest_common_divisor(int a, int b) {
+    while (b) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+static ResampleTiming rational_timing(int up, int down) {
+    int divisor = greatest_common_divisor(up, down);
+    ResampleTiming timing = { (uint64_t)(up / divisor), (uint64_t)(down / divisor), false };
+    return timing;
+}
+
+// Exact up / down from the continued fraction of the ratio when one fits the factor limit,
+// otherwise a 32.32 fixed-point step with interpolated phases
+static bool ratio_timing(double input_rate, double output_rate, ResampleTiming *timing) {
+    double ratio = output_rate / input_rate;
+    if (!(ratio >= 1.0 / STFT_MAX_RESAMPLE_RATIO && ratio <= STFT_MAX_RESAMPLE_RATIO)) return false;
+    
+    double remainder = ratio;
+    long long h0 = 0, h1 = 1, k0 = 1, k1 = 0;
+    for (int term = 0; term < 64; term++) {
+        double whole = floor(remainder);
+        long long h2 = (long long)whole * h1 + h0;
+        long long k2 = (long long)whole * k1 + k0;
+        if (h2 > STFT_MAX_RESAMPLE_FACTOR || k2 > STFT_MAX_RESAMPLE_FACTOR) break;
+        h0 = h1;
+        h1 = h2;
+        k0 = k1;
+        k1 = k2;
+        if (fabs((double)h1 / k1 - ratio) <= 1e-12 * ratio) {
+            *timing = rational_timing((int)h1, (int)k1);
+            return true;
+        }
+        if (remainder - whole < 1e-15) break;
+        remainder = 1.0 / (remainder - whole);
+    }
+    
+    timing->denominator = (uint64_t)1 << RESAMPLE_FRACTION_BITS;
+    timing->step = (uint64_t)llround(ldexp(input_rate / output_rate, RESAMPLE_FRACTION_BITS));
+    timing->interpolate = true;
+    return true;
+}
+
+// Modified Bessel function of the first kind, order 0, for the Kaiser window
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++) {
+        double half_x = x / (2.0 * k);
+        term *= half_x * half_x;
+        sum += term;
+    }
+    return sum;
+}
+
+static ResampleTable* build_table(const ResampleTiming *timing, const ResampleOptions *options) {
+    ResampleTable *table = (ResampleTable*)calloc(1, sizeof(ResampleTable));
+    if (!table) return NULL;
+    table->timing = *timing;
+    table->options = *options;
+    
+    // Phases sit every 1 / units input samples; the prototype reaches span_units of them either side
+    double ratio = (double)timing->denominator / timing->step;
+    double stretch = ratio < 1.0 ? 1.0 / ratio : 1.0;
+    int units;
+    int phases;
+    int span_units;
+    if (timing->interpolate) {
+        units = 1 << RESAMPLE_PHASE_BITS;
+        phases = units + 1;
+        span_units = (int)ceil(options->zero_crossings * stretch) * units;
+        table->phase_shift = RESAMPLE_FRACTION_BITS - RESAMPLE_PHASE_BITS;
+    } else {
+        int up = (int)timing->denominator;
+        int down = (int)timing->step;
+        units = up;
+        phases = up;
+        span_units = options->zero_crossings * (up > down ? up : down);
+        table->phase_shift = 0;
+    }
+    table->taps = ((2 * span_units) / units + 1 + 3) & ~3;
+    table->start_position = span_units / units;
+    table->start_fraction = (uint64_t)(span_units % units) << table->phase_shift;
+    
+    table->coeffs = (float*)stft_mem_aligned_alloc(NULL, (size_t)phases * table->taps * sizeof(float));
+    if (!table->coeffs) {
+        free(table);
+        return NULL;
+    }
+    
+    double fc = options->cutoff * (ratio < 1.0 ? ratio : 1.0);
+    double window_norm = bessel_i0(options->kaiser_beta);
+    for (int p = 0; p < phases; p++) {
+        float *coeffs = table->coeffs + (size_t)p * table->taps;
+        double sum = 0.0;
+        for (int j = 0; j < table->taps; j++) {
+            // Tap j of phase p weighs input base - j, offset units away from the output's time
+            int offset = j * units + p - span_units;
+            double value = 0.0;
+            if (offset <= span_units) {
+                double tau = (double)offset / units;
+                double edge = (double)offset / span_units;
+                double sinc = offset == 0 ? 1.0 : sin(M_PI * fc * tau) / (M_PI * fc * tau);
+                value = sinc * bessel_i0(options->kaiser_beta * sqrt(1.0 - edge * edge)) / window_norm;
+            }
+            coeffs[table->taps - 1 - j] = (float)value;
+            sum += value;
+        }
+        // Unit DC gain per phase, so a constant input stays constant at every output position
+        for (int j = 0; j < table->taps; j++) {
+            coeffs[j] = (float)(coeffs[j] / sum);
+        }
+    }
+    return table;
+}
+
+static bool same_table(const ResampleTable *table, const ResampleTiming *timing, const ResampleOptions *options) {
+    return table->timing.denominator == timing->denominator && table->timing.step == timing->step &&
+           table->timing.interpolate == timing->interpolate &&
+           table->options.zero_crossings == options->zero_crossings &&
+           table->options.cutoff == options->cutoff && table->options.kaiser_beta == options->kaiser_beta;
+}
+
+// Tables stay cached while any resampler holds them, so plans, streams and batch jobs at the
+// same ratio design the filter once
+static ResampleTable* acquire_table(const ResampleTiming *timing, const ResampleOptions *options) {
+    pthread_mutex_lock(&table_lock);
+    ResampleTable *table = table_cache;
+    while (table && !same_table(table, timing, options)) table = table->next;
+    if (!table) {
+        table = build_table(timing, options);
+        if (table) {
+            table->next = table_cache;
+            table_cache = table;
+        }
+    }
+    if (table) table->references++;
+    pthread_mutex_unlock(&table_lock);
+    return table;
+}
+
+static void release_table(ResampleTable *table) {
+    if (!table) return;
+    
+    pthread_mutex_lock(&table_lock);
+    if (--table->references == 0) {
+        ResampleTable **link = &table_cache;
+        while (*link != table) link = &(*link)->next;
+        *link = table->next;
+        stft_mem_aligned_free(NULL, table->coeffs);
+        free(table);
+    }
+    pthread_mutex_unlock(&table_lock);
+}
+
+static STFTResampler* create_resampler(const ResampleTiming *timing, const ResampleOptions *options,
+                                       const STFTAllocator *allocator) {
+    STFTResampler *resampler = (STFTResampler*)stft_mem_calloc(allocator, 1, sizeof(STFTResampler));
+    if (!resampler) return NULL;
+    // Zeroed by calloc when NULL, which the stft_mem_* helpers treat as malloc/free
+    if (allocator) resampler->allocator = *allocator;
+    
+    resampler->table = acquire_table(timing, options);
+    if (!resampler->table) {
+        stft_resampler_free(resampler);
+        return NULL;
+    }
+    resampler->step_whole = timing->step / timing->denominator;
+    resampler->step_fraction = timing->step % timing->denominator;
+    resampler->capacity = resampler->table->taps - 1 + RESAMPLE_CHUNK;
+    resampler->buffer = (float*)stft_mem_aligned_alloc(allocator, (size_t)resampler->capacity * sizeof(float));
+    if (!resampler->buffer) {
+        stft_resampler_free(resampler);
+        return NULL;
+    }
+    
+    stft_resampler_reset(resampler);
+    return resampler;
+}
+
+STFTResampler* stft_resampler_create(int up, int down, const ResampleOptions *options) {
+    ResampleOptions defaults = resample_default_options();
+    if (!options) options = &defaults;
+    if (up < 1 || down < 1 || up > STFT_MAX_RESAMPLE_FACTOR || down > STFT_MAX_RESAMPLE_FACTOR ||
+        !valid_options(options)) {
+        return NULL;
+    }
+    
+    ResampleTiming timing = rational_timing(up, down);
+    return create_resampler(&timing, options, NULL);
+}
+
+STFTResampler* stft_resampler_create_ratio(double input_rate, double output_rate, const ResampleOptions *options) {
+    ResampleOptions defaults = resample_default_options();
+    if (!options) options = &defaults;
+    ResampleTiming timing;
+    if (!(input_rate > 0.0 && output_rate > 0.0) || !valid_options(options) ||
+        !ratio_timing(input_rate, output_rate, &timing)) {
+        return NULL;
+    }
+    return create_resampler(&timing, options, NULL);
+}
+
+// ceil(count * denominator / step): count < 2^31 and denominator <= 2^32, so the product fits
+static int64_t timing_length(const ResampleTiming *timing, int count) {
+    if (count <= 0) return 0;
+    return (int64_t)(((uint64_t)count * timing->denominator + timing->step - 1) / timing->step);
+}
+
+int64_t stft_resampler_max_output(const STFTResampler *resampler, int count) {
+    return timing_length(&resampler->table->timing, count) + 1;
+}
+
+int64_t stft_resampled_length(const STFTResampler *resampler, int input_length) {
+    return timing_length(&resampler->table->timing, input_length);
+}
+
+void stft_resampler_reset(STFTResampler *resampler) {
+    const ResampleTable *table = resampler->table;
+    memset(resampler->buffer, 0, (table->taps - 1) * sizeof(float));
+    resampler->fill = table->taps - 1;
+    // Output 0 is centred on input 0, with the samples before it taken as silence
+    resampler->position = table->taps - 1 + table->start_position;
+    resampler->fraction = table->start_fraction;
+}
+
+#if defined(__SSE2__)
+static inline float horizontal_sum(__m128 v) {
+    __m128 pairs = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_movehl_ps(pairs, pairs)));
+}
+#endif
+
+// One phase against taps samples; coeffs is 16-byte aligned and taps a multiple of 4
+static float dot_product(const float *coeffs, const float *samples, int taps) {
+    int j = 0;
+#if defined(__SSE2__)
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; j + 8 <= taps; j += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_load_ps(coeffs + j), _mm_loadu_ps(samples + j)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_load_ps(coeffs + j + 4), _mm_loadu_ps(samples + j + 4)));
+    }
+    if (j < taps) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_load_ps(coeffs + j), _mm_loadu_ps(samples + j)));
+    }
+    return horizontal_sum(_mm_add_ps(sum0, sum1));
+#else
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    for (; j < taps; j += 4) {
+        s0 += coeffs[j] * samples[j];
+        s1 += coeffs[j + 1] * samples[j + 1];
+        s2 += coeffs[j + 2] * samples[j + 2];
+        s3 += coeffs[j + 3] * samples[j + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+#endif
+}
+
+// Two neighbouring phases in one pass over the samples, blended by weight
+static float interpolated_dot_product(const float *coeffs, const float *next, const float *samples, int taps,
+                                      float weight) {
+#if defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    __m128 sum_next = _mm_setzero_ps();
+    for (int j = 0; j < taps; j += 4) {
+        __m128 x = _mm_loadu_ps(samples + j);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(coeffs + j), x));
+        sum_next = _mm_add_ps(sum_next, _mm_mul_ps(_mm_load_ps(next + j), x));
+    }
+    float a = horizontal_sum(sum);
+    float b = horizontal_sum(sum_next);
+#else
+    float a = 0.0f, b = 0.0f;
+    for (int j = 0; j < taps; j++) {
+        a += coeffs[j] * samples[j];
+        b += next[j] * samples[j];
+    }
+#endif
+    return a + weight * (b - a);
+}
+
+static float phase_weight(const ResampleTable *table, uint64_t fraction) {
+    uint64_t below = fraction & (((uint64_t)1 << table->phase_shift) - 1);
+    return (float)ldexp((double)below, -table->phase_shift);
+}
+
+static float phase_output(const ResampleTable *table, uint64_t fraction, const float *samples) {
+    const float *coeffs = table->coeffs + (size_t)(fraction >> table->phase_shift) * table->taps;
+    if (!table->timing.interpolate) return dot_product(coeffs, samples, table->taps);
+    return interpolated_dot_product(coeffs, coeffs + table->taps, samples, table->taps, phase_weight(table, fraction));
+}
+
+// Writes up to limit outputs whose input is fully buffered
+static int resample_run(STFTResampler *resampler, float *output, int limit) {
+    const ResampleTable *table = resampler->table;
+    uint64_t denominator = table->timing.denominator;
+    int written = 0;
+    while (resampler->position < resampler->fill && written < limit) {
+        output[written++] = phase_output(table, resampler->fraction, resampler->buffer + resampler->position - table->taps + 1);
+        resampler->fraction += resampler->step_fraction;
+        resampler->position += (int)resampler->step_whole;
+        if (resampler->fraction >= denominator) {
+            resampler->fraction -= denominator;
+            resampler->position++;
+        }
+    }
+    return written;
+}
+
+// Appends count samples (silence if input is NULL) and writes up to limit outputs
+static int resample_feed(STFTResampler *resampler, const float *input, int count, float *output, int limit) {
+    int written = 0;
+    while (count > 0 && written < limit) {
+        int take = resampler->capacity - resampler->fill;
+        if (take > count) take = count;
+        if (input) {
+            memcpy(resampler->buffer + resampler->fill, input, take * sizeof(float));
+            input += take;
+        } else {
+            memset(resampler->buffer + resampler->fill, 0, take * sizeof(float));
+        }
+        resampler->fill += take;
+        count -= take;
+    
+        written += resample_run(resampler, output + written, limit - written);
+    
+        // Drop what no later output reaches; after a full run at most taps - 1 samples remain
+        int drop = resampler->position - (resampler->table->taps - 1);
+        if (drop > resampler->fill) drop = resampler->fill;
+        if (drop > 0) {
+            memmove(resampler->buffer, resampler->buffer + drop, (resampler->fill - drop) * sizeof(float));
+            resampler->fill -= drop;
+            resampler->position -= drop;
+        }
+    }
+    return written;
+}
+
+int stft_resampler_process(STFTResampler *resampler, const float *input, int count, float *output) {
+    return resample_feed(resampler, input, count, output, INT_MAX);
+}
+
+int stft_resampler_resample(STFTResampler *resampler, const float *input, int input_length, float *output) {
+    int64_t full_length = stft_resampled_length(resampler, input_length);
+    if (full_length > INT_MAX) return -1;
+    int length = (int)full_length;
+    stft_resampler_reset(resampler);
+    
+    int written = resample_feed(resampler, input, input_length, output, length);
+    while (written < length) {
+        written += resample_feed(resampler, NULL, RESAMPLE_CHUNK, output + written, length - written);
+    }
+    
+    stft_resampler_reset(resampler);
+    return length;
+}
+
+// Scalar dot product over the part of the filter that overlaps [0, input_length)
+static float clipped_output(const ResampleTable *table, uint64_t fraction, const float *input, int input_length,
+                            int64_t first) {
+    int lo = first < 0 ? (int)-first : 0;
+    int hi = first + table->taps > input_length ? (int)(input_length - first) : table->taps;
+    const float *coeffs = table->coeffs + (size_t)(fraction >> table->phase_shift) * table->taps;
+    
+    float a = 0.0f, b = 0.0f;
+    for (int j = lo; j < hi; j++) {
+        a += coeffs[j] * input[first + j];
+        if (table->timing.interpolate) b += coeffs[table->taps + j] * input[first + j];
+    }
+    return table->timing.interpolate ? a + phase_weight(table, fraction) * (b - a) : a;
+}
+
+void stft_resampler_render(const STFTResampler *resampler, const float *input, int input_length,
+                           int first_output, int count, float *output) {
+    const ResampleTable *table = resampler->table;
+    uint64_t denominator = table->timing.denominator;
+    int taps = table->taps;
+    
+    // Time of first_output computed directly; the whole and fractional parts are multiplied
+    // separately so neither product overflows
+    uint64_t fraction = table->start_fraction + (uint64_t)first_output * resampler->step_fraction;
+    int64_t position = table->start_position + (int64_t)first_output * (int64_t)resampler->step_whole +
+                       (int64_t)(fraction / denominator);
+    fraction %= denominator;
+    
+    for (int k = 0; k < count; k++) {
+        // Input window of this output: [position - taps + 1, position]
+        int64_t first = position - taps + 1;
+        if (first >= 0 && position < input_length) {
+            output[k] = phase_output(table, fraction, input + first);
+        } else if (first < input_length && position >= 0) {
+            output[k] = clipped_output(table, fraction, input, input_length, first);
+        } else {
+            output[k] = 0.0f;
+        }
+        fraction += resampler->step_fraction;
+        position += (int64_t)resampler->step_whole;
+        if (fraction >= denominator) {
+            fraction -= denominator;
+            position++;
+        }
+    }
+}
+
+void stft_resampler_free(STFTResampler *resampler) {
+    if (!resampler) return;
+    
+    STFTAllocator allocator = resampler->allocator;
+    release_table(resampler->table);
+    stft_mem_aligned_free(&allocator, resampler->buffer);
+    stft_mem_free(&allocator, resampler);
+}
+
+bool stft_resamples(const STFTParameters *params) {
+    if (params->target_sample_rate > 0.0) return params->target_sample_rate != params->sample_rate;
+    int up = params->resample_up > 1 ? params->resample_up : 1;
+    int down = params->resample_down > 1 ? params->resample_down : 1;
+    return up != down;
+}
+
+static bool params_timing(const STFTParameters *params, ResampleTiming *timing) {
+    if (params->target_sample_rate > 0.0) {
+        return ratio_timing(params->sample_rate, params->target_sample_rate, timing);
+    }
+    *timing = rational_timing(params->resample_up > 1 ? params->resample_up : 1,
+                              params->resample_down > 1 ? params->resample_down : 1);
+    return true;
+}
+
+int64_t stft_params_resampled_length(const STFTParameters *params, int input_length) {
+    ResampleTiming timing;
+    if (!params_timing(params, &timing)) return 0;
+    return timing_length(&timing, input_length);
+}
+
+STFTResampler* stft_params_resampler(const STFTParameters *params, const STFTAllocator *allocator) {
+    ResampleOptions options = resample_default_options();
+    ResampleTiming timing;
+    if (!params_timing(params, &timing)) return NULL;
+    return create_resampler(&timing, &options, allocator);
+}
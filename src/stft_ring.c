@@ -0,0 +1,275 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/stft_ring.h"
+#include "../include/stft_stream.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CACHE_LINE 64
+
+// head and tail are free-running counters; the slot is counter & mask. Each side keeps a
+// cached copy of the other side's index on its own line and only reloads it when the cached
+// value leaves too little room (producer) or data (consumer).
+struct STFTRing {
+    size_t head;                // written by the producer only
+    size_t cached_tail;
+    char producer_pad[CACHE_LINE - 2 * sizeof(size_t)];
+    
+    size_t tail;                // written by the consumer only
+    size_t cached_head;
+    char consumer_pad[CACHE_LINE - 2 * sizeof(size_t)];
+    
+    size_t mask;
+    size_t element_size;
+    unsigned char *data;
+};
+
+STFTRing* stft_ring_create(size_t capacity, size_t element_size) {
+    if (capacity == 0 || element_size == 0) return NULL;
+    
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    
+    STFTRing *ring = NULL;
+    if (posix_memalign((void**)&ring, CACHE_LINE, sizeof(STFTRing)) != 0) return NULL;
+    memset(ring, 0, sizeof(STFTRing));
+    
+    ring->mask = rounded - 1;
+    ring->element_size = element_size;
+    if (posix_memalign((void**)&ring->data, CACHE_LINE, rounded * element_size) != 0) {
+        free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void stft_ring_free(STFTRing *ring) {
+    if (!ring) return;
+    free(ring->data);
+    free(ring);
+}
+
+size_t stft_ring_capacity(const STFTRing *ring) {
+    return ring->mask + 1;
+}
+
+// Free slots, reloading the consumer's index only when the cached one leaves too few
+static size_t writable(STFTRing *ring, size_t wanted) {
+    size_t capacity = ring->mask + 1;
+    if (capacity - (ring->head - ring->cached_tail) < wanted) {
+        ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    }
+    return capacity - (ring->head - ring->cached_tail);
+}
+
+static size_t readable(STFTRing *ring, size_t wanted) {
+    if (ring->cached_head - ring->tail < wanted) {
+        ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    }
+    return ring->cached_head - ring->tail;
+}
+
+size_t stft_ring_write_available(STFTRing *ring) {
+    return writable(ring, ring->mask + 1);
+}
+
+size_t stft_ring_read_available(STFTRing *ring) {
+    return readable(ring, ring->mask + 1);
+}
+
+// Copies count elements between a linear buffer and the ring starting at counter, in at most two pieces
+static void ring_copy(STFTRing *ring, size_t counter, void *linear, size_t count, bool into_ring) {
+    size_t slot = counter & ring->mask;
+    size_t first = ring->mask + 1 - slot < count ? ring->mask + 1 - slot : count;
+    unsigned char *bytes = (unsigned char*)linear;
+    
+    if (into_ring) {
+        memcpy(ring->data + slot * ring->element_size, bytes, first * ring->element_size);
+        memcpy(ring->data, bytes + first * ring->element_size, (count - first) * ring->element_size);
+    } else {
+        memcpy(bytes, ring->data + slot * ring->element_size, first * ring->element_size);
+        memcpy(bytes + first * ring->element_size, ring->data, (count - first) * ring->element_size);
+    }
+}
+
+size_t stft_ring_write(STFTRing *ring, const void *elements, size_t count) {
+    size_t available = writable(ring, count);
+    if (count > available) count = available;
+    if (count == 0) return 0;
+    
+    ring_copy(ring, ring->head, (void*)elements, count, true);
+    __atomic_store_n(&ring->head, ring->head + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+size_t stft_ring_read(STFTRing *ring, void *elements, size_t count) {
+    size_t available = readable(ring, count);
+    if (count > available) count = available;
+    if (count == 0) return 0;
+    
+    ring_copy(ring, ring->tail, elements, count, false);
+    __atomic_store_n(&ring->tail, ring->tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+void* stft_ring_write_slot(STFTRing *ring) {
+    if (writable(ring, 1) == 0) return NULL;
+    return ring->data + (ring->head & ring->mask) * ring->element_size;
+}
+
+void stft_ring_publish(STFTRing *ring) {
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+const void* stft_ring_read_slot(STFTRing *ring) {
+    if (readable(ring, 1) == 0) return NULL;
+    return ring->data + (ring->tail & ring->mask) * ring->element_size;
+}
+
+void stft_ring_release(STFTRing *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+// Frame ring element: this header, then bin_count bins
+typedef struct {
+    int index;
+    int start_sample;
+    int gated;
+    int reserved;
+} RingFrameHeader;
+
+#define WORKER_CHUNK 1024       // samples moved from the ring to the stream per step
+#define WORKER_IDLE_NS 200000   // sleep when the sample ring is empty
+
+struct STFTRealtime {
+    STFTRing *samples;
+    STFTRing *frames;
+    STFTStream *stream;
+    int bin_count;
+    pthread_t worker;
+    bool running;
+    int stop;
+    
+    // Each counter is written by a single thread and read with relaxed loads
+    uint64_t samples_pushed;
+    uint64_t samples_dropped;
+    uint64_t frames_published;
+    uint64_t frames_dropped;
+    uint64_t underruns;
+    
+    float chunk[WORKER_CHUNK];
+};
+
+static void publish_frame(const STFTFrame *frame, void *user_data) {
+    STFTRealtime *realtime = (STFTRealtime*)user_data;
+    
+    RingFrameHeader *slot = (RingFrameHeader*)stft_ring_write_slot(realtime->frames);
+    if (!slot) {
+        __atomic_store_n(&realtime->frames_dropped, realtime->frames_dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    slot->index = frame->index;
+    slot->start_sample = frame->start_sample;
+    slot->gated = frame->gated;
+    memcpy(slot + 1, frame->bins, frame->bin_count * sizeof(kiss_fft_cpx));
+    stft_ring_publish(realtime->frames);
+    __atomic_store_n(&realtime->frames_published, realtime->frames_published + 1, __ATOMIC_RELAXED);
+}
+
+static void* realtime_worker(void *arg) {
+    STFTRealtime *realtime = (STFTRealtime*)arg;
+    struct timespec idle = { 0, WORKER_IDLE_NS };
+    
+    while (!__atomic_load_n(&realtime->stop, __ATOMIC_ACQUIRE)) {
+        size_t count = stft_ring_read(realtime->samples, realtime->chunk, WORKER_CHUNK);
+        if (count == 0) {
+            // The audio thread must not signal, so an empty ring is polled
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        stft_stream_push(realtime->stream, realtime->chunk, (int)count, publish_frame, realtime);
+    }
+    return NULL;
+}
+
+STFTRealtime* stft_realtime_create(const STFTParameters *params, size_t sample_capacity, size_t frame_capacity) {
+    if (!params || params->window_size <= 0) return NULL;
+    
+    STFTRealtime *realtime = (STFTRealtime*)calloc(1, sizeof(STFTRealtime));
+    if (!realtime) return NULL;
+    
+    realtime->bin_count = params->window_size / 2 + 1;
+    realtime->stream = stft_stream_create(params);
+    realtime->samples = stft_ring_create(sample_capacity, sizeof(float));
+    realtime->frames = stft_ring_create(frame_capacity, sizeof(RingFrameHeader) + realtime->bin_count * sizeof(kiss_fft_cpx));
+    if (!realtime->stream || !realtime->samples || !realtime->frames) {
+        stft_realtime_free(realtime);
+        return NULL;
+    }
+    
+    if (pthread_create(&realtime->worker, NULL, realtime_worker, realtime) != 0) {
+        stft_realtime_free(realtime);
+        return NULL;
+    }
+    realtime->running = true;
+    return realtime;
+}
+
+int stft_realtime_push(STFTRealtime *realtime, const float *samples, int count) {
+    if (count <= 0) return 0;
+    
+    int accepted = (int)stft_ring_write(realtime->samples, samples, (size_t)count);
+    __atomic_store_n(&realtime->samples_pushed, realtime->samples_pushed + accepted, __ATOMIC_RELAXED);
+    if (accepted < count) {
+        __atomic_store_n(&realtime->samples_dropped, realtime->samples_dropped + (count - accepted), __ATOMIC_RELAXED);
+    }
+    return accepted;
+}
+
+int stft_realtime_pop_frame(STFTRealtime *realtime, kiss_fft_cpx *bins, STFTFrame *frame) {
+    const RingFrameHeader *slot = (const RingFrameHeader*)stft_ring_read_slot(realtime->frames);
+    if (!slot) {
+        __atomic_store_n(&realtime->underruns, realtime->underruns + 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    
+    memcpy(bins, slot + 1, realtime->bin_count * sizeof(kiss_fft_cpx));
+    if (frame) {
+        memset(frame, 0, sizeof(STFTFrame));
+        frame->index = slot->index;
+        frame->start_sample = slot->start_sample;
+        frame->gated = slot->gated != 0;
+        frame->bins = bins;
+        frame->bin_count = realtime->bin_count;
+    }
+    stft_ring_release(realtime->frames);
+    return 1;
+}
+
+int stft_realtime_bin_count(const STFTRealtime *realtime) {
+    return realtime->bin_count;
+}
+
+STFTRealtimeStats stft_realtime_stats(const STFTRealtime *realtime) {
+    STFTRealtimeStats stats;
+    stats.samples_pushed = __atomic_load_n(&realtime->samples_pushed, __ATOMIC_RELAXED);
+    stats.samples_dropped = __atomic_load_n(&realtime->samples_dropped, __ATOMIC_RELAXED);
+    stats.frames_published = __atomic_load_n(&realtime->frames_published, __ATOMIC_RELAXED);
+    stats.frames_dropped = __atomic_load_n(&realtime->frames_dropped, __ATOMIC_RELAXED);
+    stats.underruns = __atomic_load_n(&realtime->underruns, __ATOMIC_RELAXED);
+    return stats;
+}
+
+void stft_realtime_free(STFTRealtime *realtime) {
+    if (!realtime) return;
+    
+    if (realtime->running) {
+        __atomic_store_n(&realtime->stop, 1, __ATOMIC_RELEASE);
+        pthread_join(realtime->worker, NULL);
+    }
+    stft_stream_free(realtime->stream);
+    stft_ring_free(realtime->samples);
+    stft_ring_free(realtime->frames);
+    free(realtime);
+}
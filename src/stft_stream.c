@@ -0,0 +1,218 @@
+#include "../include/stft_stream.h"
+#include "stft_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+// Input samples run through the resampling pre-stage per pass
+#define STREAM_RESAMPLE_BLOCK 1024
+
+struct STFTStream {
+    STFTFrameEngine engine;
+    int hop_size;
+    int fill;               // valid samples at the start of buffer
+    int frame_index;
+    float *buffer;          // window_size samples
+    STFTResampler *resampler;   // NULL unless the parameters resample
+    float *resampled;       // output of one STREAM_RESAMPLE_BLOCK pass
+};
+
+struct STFTSynthesis {
+    int window_size;
+    int hop_size;
+    int bin_count;
+    float unscale;
+    float *window;
+    float *accumulator;     // window_size samples of pending overlap-add
+    float *norm;            // hop_size steady-state window-power sums
+    kiss_fft_cfg cfg;
+    kiss_fft_cpx *spectrum;
+    kiss_fft_cpx *frame_data;
+};
+
+STFTStream* stft_stream_create(const STFTParameters *params) {
+    char *error = stft_validate_parameters(params);
+    if (error) {
+        free(error);
+        return NULL;
+    }
+    
+    STFTStream *stream = (STFTStream*)calloc(1, sizeof(STFTStream));
+    if (!stream) return NULL;
+    
+    error = stft_engine_init(&stream->engine, params, NULL);
+    stream->buffer = (float*)malloc(params->window_size * sizeof(float));
+    if (error || !stream->buffer) {
+        free(error);
+        stft_stream_free(stream);
+        return NULL;
+    }
+    stream->hop_size = params->hop_size;
+    
+    if (stft_resamples(params)) {
+        stream->resampler = stft_params_resampler(params, NULL);
+        // One pass's output is counted in an int, so a block that could resample past INT_MAX is rejected
+        int64_t block_output = stream->resampler ? stft_resampler_max_output(stream->resampler, STREAM_RESAMPLE_BLOCK) : 0;
+        stream->resampled = block_output > 0 && block_output <= INT_MAX
+            ? (float*)malloc((size_t)block_output * sizeof(float))
+            : NULL;
+        if (!stream->resampled) {
+            stft_stream_free(stream);
+            return NULL;
+        }
+    }
+    
+    return stream;
+}
+
+// Frames samples that are already at the analysis rate
+static int push_analysis_samples(STFTStream *stream, const float *samples, int count,
+                                 STFTFrameCallback callback, void *user_data) {
+    int window_size = stream->engine.window_size;
+    int frames = 0;
+    
+    while (count > 0) {
+        int take = window_size - stream->fill;
+        if (take > count) take = count;
+        memcpy(stream->buffer + stream->fill, samples, take * sizeof(float));
+        stream->fill += take;
+        samples += take;
+        count -= take;
+        
+        if (stream->fill < window_size) break;
+        
+        STFTFrame frame_info;
+        frame_info.gated = stft_engine_transform(&stream->engine, stream->buffer);
+        frame_info.index = stream->frame_index;
+        frame_info.start_sample = stream->frame_index * stream->hop_size;
+        frame_info.bins = stream->engine.fft_output;
+        frame_info.bin_count = stream->engine.bin_count;
+        frame_info.real = stream->engine.split_real;
+        frame_info.imag = stream->engine.split_imag;
+        callback(&frame_info, user_data);
+        
+        stream->frame_index++;
+        frames++;
+        
+        // Keep the overlap for the next frame
+        memmove(stream->buffer, stream->buffer + stream->hop_size, (window_size - stream->hop_size) * sizeof(float));
+        stream->fill = window_size - stream->hop_size;
+    }
+    
+    return frames;
+}
+
+int stft_stream_push(STFTStream *stream, const float *samples, int count, STFTFrameCallback callback, void *user_data) {
+    if (!stream->resampler) return push_analysis_samples(stream, samples, count, callback, user_data);
+    
+    int frames = 0;
+    while (count > 0) {
+        int take = count < STREAM_RESAMPLE_BLOCK ? count : STREAM_RESAMPLE_BLOCK;
+        int produced = stft_resampler_process(stream->resampler, samples, take, stream->resampled);
+        frames += push_analysis_samples(stream, stream->resampled, produced, callback, user_data);
+        samples += take;
+        count -= take;
+    }
+    return frames;
+}
+
+int stft_stream_samples_until_frame(const STFTStream *stream) {
+    return stream->engine.window_size - stream->fill;
+}
+
+void stft_stream_reset(STFTStream *stream) {
+    stream->fill = 0;
+    stream->frame_index = 0;
+    if (stream->resampler) stft_resampler_reset(stream->resampler);
+}
+
+void stft_stream_free(STFTStream *stream) {
+    if (!stream) return;
+    
+    stft_engine_destroy(&stream->engine);
+    free(stream->buffer);
+    stft_resampler_free(stream->resampler);
+    free(stream->resampled);
+    free(stream);
+}
+
+STFTSynthesis* stft_synthesis_create(const STFTParameters *params) {
+    char *error = stft_validate_parameters(params);
+    if (error) {
+        free(error);
+        return NULL;
+    }
+    
+    STFTSynthesis *synthesis = (STFTSynthesis*)calloc(1, sizeof(STFTSynthesis));
+    if (!synthesis) return NULL;
+    
+    int window_size = params->window_size;
+    synthesis->window_size = window_size;
+    synthesis->hop_size = params->hop_size;
+    synthesis->bin_count = window_size / 2 + 1;
+    synthesis->window = generate_window(params->window_type, window_size);
+    synthesis->accumulator = (float*)calloc(window_size, sizeof(float));
+    synthesis->norm = (float*)calloc(params->hop_size, sizeof(float));
+    synthesis->cfg = kiss_fft_alloc(window_size, 1, NULL, NULL);
+    synthesis->spectrum = (kiss_fft_cpx*)malloc(window_size * sizeof(kiss_fft_cpx));
+    synthesis->frame_data = (kiss_fft_cpx*)malloc(window_size * sizeof(kiss_fft_cpx));
+    
+    if (!synthesis->window || !synthesis->accumulator || !synthesis->norm || !synthesis->cfg ||
+        !synthesis->spectrum || !synthesis->frame_data) {
+        stft_synthesis_free(synthesis);
+        return NULL;
+    }
+    
+    synthesis->unscale = 1.0f / (stft_window_scale(params, synthesis->window) * window_size);
+    
+    // Once the overlap is full, each output sample has received window^2 from every frame covering it
+    for (int i = 0; i < window_size; i++) {
+        synthesis->norm[i % params->hop_size] += synthesis->window[i] * synthesis->window[i];
+    }
+    
+    return synthesis;
+}
+
+void stft_synthesis_push(STFTSynthesis *synthesis, const kiss_fft_cpx *bins, float *output) {
+    int window_size = synthesis->window_size;
+    int hop_size = synthesis->hop_size;
+    
+    for (int bin = 0; bin < synthesis->bin_count; bin++) {
+        synthesis->spectrum[bin] = bins[bin];
+    }
+    for (int bin = synthesis->bin_count; bin < window_size; bin++) {
+        synthesis->spectrum[bin].r = bins[window_size - bin].r;
+        synthesis->spectrum[bin].i = -bins[window_size - bin].i;
+    }
+    
+    kiss_fft(synthesis->cfg, synthesis->spectrum, synthesis->frame_data);
+    
+    for (int i = 0; i < window_size; i++) {
+        synthesis->accumulator[i] += synthesis->frame_data[i].r * synthesis->unscale * synthesis->window[i];
+    }
+    
+    // The first hop_size samples will receive no further frames
+    for (int i = 0; i < hop_size; i++) {
+        float norm = synthesis->norm[i];
+        output[i] = norm > 1e-8f ? synthesis->accumulator[i] / norm : 0.0f;
+    }
+    memmove(synthesis->accumulator, synthesis->accumulator + hop_size, (window_size - hop_size) * sizeof(float));
+    memset(synthesis->accumulator + window_size - hop_size, 0, hop_size * sizeof(float));
+}
+
+void stft_synthesis_reset(STFTSynthesis *synthesis) {
+    memset(synthesis->accumulator, 0, synthesis->window_size * sizeof(float));
+}
+
+void stft_synthesis_free(STFTSynthesis *synthesis) {
+    if (!synthesis) return;
+    
+    free(synthesis->window);
+    free(synthesis->accumulator);
+    free(synthesis->norm);
+    kiss_fft_free(synthesis->cfg);
+    free(synthesis->spectrum);
+    free(synthesis->frame_data);
+    free(synthesis);
+}
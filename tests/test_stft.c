@@ -1,9 +1,25 @@
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
+#include <time.h>
+#include <unistd.h>
 #include "stft.h"
+#include "stft_chroma.h"
+#include "stft_pitch.h"
+#include "stft_peaks.h"
+#include "stft_hpss.h"
+#include "stft_stream.h"
+#include "stft_denoise.h"
+#include "stft_encode.h"
+#include "stft_arena.h"
+#include "stft_batch.h"
+#include "stft_ring.h"
+#include "stft_async.h"
+#include "stft_resample.h"
 
 #define EPSILON 1e-4
 
@@ -291,6 +307,1419 @@ void test_time_varying_signal() {
     }
 }
 
+void test_chroma() {
+    double sample_rate = 44100.0;
+    int sample_count;
+    
+    float *signal = generate_sine_wave(440.0, 1.0, 0.5, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Chroma test signal generation");
+    
+    if (signal) {
+        STFTParameters params = stft_create_parameters(4096, 2048, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        ChromaMap *map = chroma_map_create(sample_rate, params.window_size, 440.0, 55.0, 5000.0);
+        test_assert(map != NULL && map->entry_count > 0, "Chroma map creation");
+        
+        ChromaResult *chroma = perform_stft_chroma(signal, sample_count, &params, map);
+        test_assert(chroma != NULL && chroma->success, "Chroma computation");
+        
+        if (chroma && chroma->success) {
+            test_assert(chroma->frame_count == stft_get_frame_count(&params, sample_count), "Chroma frame count");
+            
+            int max_class = 0;
+            for (int pc = 1; pc < CHROMA_BIN_COUNT; pc++) {
+                if (chroma->chroma[pc] > chroma->chroma[max_class]) max_class = pc;
+            }
+            test_assert(max_class == 9, "A4 tone maps to pitch class A");
+            test_assert(float_equals(chroma->chroma[max_class], 1.0, EPSILON), "Chroma frame normalized to peak");
+        }
+        
+        STFTParameters mismatched = stft_create_parameters(2048, 1024, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        ChromaResult *rejected = perform_stft_chroma(signal, sample_count, &mismatched, map);
+        test_assert(rejected != NULL && !rejected->success, "Chroma map size mismatch rejected");
+        
+        chroma_free_result(rejected);
+        chroma_free_result(chroma);
+        chroma_map_free(map);
+        free(signal);
+    }
+}
+
+void test_pitch_tracking() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    
+    float *signal = generate_sine_wave(220.0, 0.8, 0.5, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Pitch test signal generation");
+    
+    if (signal) {
+        STFTParameters params = stft_create_parameters(1024, 256, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        PitchOptions options = pitch_default_options();
+        
+        for (int smoothed = 0; smoothed <= 1; smoothed++) {
+            options.viterbi = smoothed;
+            PitchResult *pitch = perform_pitch_tracking(signal, sample_count, &params, &options);
+            test_assert(pitch != NULL && pitch->success, smoothed ? "Viterbi pitch tracking" : "YIN pitch tracking");
+            
+            if (pitch && pitch->success) {
+                int accurate = 0;
+                for (int frame = 0; frame < pitch->frame_count; frame++) {
+                    if (fabs(pitch->frequency[frame] - 220.0) < 2.0) accurate++;
+                }
+                test_assert(accurate == pitch->frame_count, "Pitch within 2 Hz of 220 Hz in every frame");
+            }
+            pitch_free_result(pitch);
+        }
+        
+        // Resampling applies to the STFT only; pitch frames stay hop_size input samples apart
+        STFTParameters resampled = params;
+        resampled.resample_down = 2;
+        PitchResult *decimated = perform_pitch_tracking(signal, sample_count, &resampled, NULL);
+        test_assert(decimated != NULL && decimated->success &&
+                    decimated->frame_count == (sample_count - 1024) / 256 + 1 &&
+                    fabs(decimated->frame_time - 256.0 / sample_rate) < 1e-12,
+                    "Pitch frame time ignores STFT resampling");
+        pitch_free_result(decimated);
+        
+        float silence[4096] = {0};
+        PitchResult *unvoiced = perform_pitch_tracking(silence, 4096, &params, NULL);
+        test_assert(unvoiced != NULL && unvoiced->success && unvoiced->frequency[0] == 0.0f, "Silence is unvoiced");
+        pitch_free_result(unvoiced);
+        
+        free(signal);
+    }
+}
+
+void test_peak_extraction() {
+    double frequencies[] = {440.0, 1000.0};
+    double amplitudes[] = {0.4, 1.0};
+    double sample_rate = 44100.0;
+    int sample_count;
+    
+    float *signal = generate_multi_tone_sine_wave(frequencies, amplitudes, 2, 0.5, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Peak test signal generation");
+    
+    if (signal) {
+        STFTParameters params = stft_create_parameters(2048, 1024, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        PeakResult *peaks = perform_stft_peaks(signal, sample_count, &params, 4, -200.0f);
+        test_assert(peaks != NULL && peaks->success, "Top-K peak extraction");
+        
+        if (peaks && peaks->success) {
+            const SpectralPeak *first = peaks->peaks;
+            test_assert(peaks->peak_count[0] >= 2, "Both tones found as peaks");
+            test_assert(fabs(first[0].frequency - 1000.0) < 2.0, "Strongest peak interpolated to 1000 Hz");
+            test_assert(fabs(first[1].frequency - 440.0) < 2.0, "Second peak interpolated to 440 Hz");
+            test_assert(first[0].amplitude > first[1].amplitude, "Peaks ordered strongest first");
+        }
+        
+        peaks_free_result(peaks);
+        free(signal);
+    }
+}
+
+void test_istft_round_trip() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    
+    float *signal = generate_time_varying_signal(sample_rate, 0.25, &sample_count);
+    test_assert(signal != NULL, "ISTFT test signal generation");
+    
+    if (signal) {
+        STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_PSD);
+        STFTResult *result = perform_stft(signal, sample_count, &params);
+        int length = 0;
+        float *reconstructed = perform_istft(result, &params, &length);
+        
+        test_assert(reconstructed != NULL, "ISTFT reconstruction");
+        test_assert(length == (result->frame_count - 1) * params.hop_size + params.window_size, "ISTFT output length");
+        
+        if (reconstructed) {
+            double max_error = 0.0;
+            for (int i = params.window_size; i < length - params.window_size; i++) {
+                max_error = fmax(max_error, fabs(reconstructed[i] - signal[i]));
+            }
+            test_assert(max_error < 1e-3, "ISTFT reconstructs input");
+            free(reconstructed);
+        }
+        
+        stft_free_result(result);
+        free(signal);
+    }
+}
+
+void test_hpss() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    
+    float *signal = generate_sine_wave(500.0, 0.5, 1.0, sample_rate, &sample_count);
+    test_assert(signal != NULL, "HPSS test signal generation");
+    
+    if (signal) {
+        // Sustained tone plus a click train
+        for (int i = 1000; i < sample_count; i += 2000) {
+            signal[i] += 4.0f;
+        }
+        
+        STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        HPSSOptions options = hpss_default_options();
+        HPSSResult *hpss = perform_hpss(signal, sample_count, &params, &options);
+        test_assert(hpss != NULL && hpss->success, "HPSS computation");
+        
+        if (hpss && hpss->success) {
+            double sum_error = 0.0;
+            double click_harmonic = 0.0, click_percussive = 0.0;
+            double tone_harmonic = 0.0, tone_percussive = 0.0;
+            for (int i = params.window_size; i < hpss->length - params.window_size; i++) {
+                sum_error = fmax(sum_error, fabs(hpss->harmonic[i] + hpss->percussive[i] - signal[i]));
+                if (i % 2000 == 1000) {
+                    click_harmonic += fabs(hpss->harmonic[i]);
+                    click_percussive += fabs(hpss->percussive[i]);
+                } else if (i % 2000 >= 400 && i % 2000 < 600) {
+                    tone_harmonic += fabs(hpss->harmonic[i]);
+                    tone_percussive += fabs(hpss->percussive[i]);
+                }
+            }
+            test_assert(sum_error < 1e-3, "Harmonic and percussive parts sum to input");
+            test_assert(click_percussive > click_harmonic, "Clicks go to percussive part");
+            test_assert(tone_harmonic > tone_percussive, "Tone goes to harmonic part");
+        }
+        
+        HPSSStream *stream = hpss_stream_create(257, &options);
+        test_assert(stream != NULL && hpss_stream_latency(stream) == options.harmonic_kernel / 2, "HPSS stream look-ahead");
+        hpss_stream_free(stream);
+        
+        hpss_free_result(hpss);
+        free(signal);
+    }
+}
+
+typedef struct {
+    STFTResult *reference;
+    int frames;
+    int mismatches;
+} StreamCheck;
+
+static void compare_stream_frame(const STFTFrame *frame, void *user_data) {
+    StreamCheck *check = (StreamCheck*)user_data;
+    const kiss_fft_cpx *expected = check->reference->spectrogram_data[frame->index];
+    for (int bin = 0; bin < frame->bin_count; bin++) {
+        if (!float_equals(frame->bins[bin].r, expected[bin].r, 1e-6) || !float_equals(frame->bins[bin].i, expected[bin].i, 1e-6)) {
+            check->mismatches++;
+        }
+    }
+    check->frames++;
+}
+
+void test_streaming_stft() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    
+    float *signal = generate_time_varying_signal(sample_rate, 0.25, &sample_count);
+    test_assert(signal != NULL, "Streaming test signal generation");
+    
+    if (signal) {
+        STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        STFTResult *reference = perform_stft(signal, sample_count, &params);
+        STFTStream *stream = stft_stream_create(&params);
+        test_assert(stream != NULL, "Streaming STFT creation");
+        
+        if (stream && reference && reference->success) {
+            StreamCheck check = { reference, 0, 0 };
+            // Deliberately awkward block size
+            for (int offset = 0; offset < sample_count; offset += 100) {
+                int count = sample_count - offset < 100 ? sample_count - offset : 100;
+                stft_stream_push(stream, signal + offset, count, compare_stream_frame, &check);
+            }
+            test_assert(check.frames == reference->frame_count, "Streaming STFT frame count");
+            test_assert(check.mismatches == 0, "Streaming STFT matches batch STFT");
+        }
+        
+        stft_stream_free(stream);
+        stft_free_result(reference);
+        free(signal);
+    }
+}
+
+void test_denoiser() {
+    double sample_rate = 16000.0;
+    int sample_count = 48000;
+    float *noisy = (float*)malloc(sample_count * sizeof(float));
+    float *clean = (float*)malloc(sample_count * sizeof(float));
+    float *output = (float*)malloc(sample_count * sizeof(float));
+    
+    // Deterministic white noise; a tone starts after two seconds
+    unsigned int seed = 12345;
+    for (int i = 0; i < sample_count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        float noise = 0.1f * (((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f);
+        clean[i] = i >= 32000 ? 0.5f * sinf(2.0f * M_PI * 440.0f * i / sample_rate) : 0.0f;
+        noisy[i] = clean[i] + noise;
+    }
+    
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    DenoiseOptions options = denoise_default_options();
+    
+    for (int rule = 0; rule <= 1; rule++) {
+        options.gain_rule = rule ? DENOISE_SPECTRAL_SUBTRACTION : DENOISE_WIENER;
+        Denoiser *denoiser = denoiser_create(&params, &options);
+        test_assert(denoiser != NULL, "Denoiser creation");
+        if (!denoiser) continue;
+        
+        // Odd block sizes exercise the hop-aligned output queue
+        for (int offset = 0; offset < sample_count; offset += 333) {
+            int count = sample_count - offset < 333 ? sample_count - offset : 333;
+            denoiser_process(denoiser, noisy + offset, count, output + offset);
+        }
+        
+        int latency = denoiser_latency(denoiser);
+        double noise_in = 0.0, noise_out = 0.0, error_in = 0.0, error_out = 0.0;
+        for (int i = 24000; i < 32000; i++) {
+            noise_in += noisy[i] * noisy[i];
+            noise_out += output[i + latency] * output[i + latency];
+        }
+        for (int i = 36000; i < sample_count - latency; i++) {
+            error_in += (noisy[i] - clean[i]) * (noisy[i] - clean[i]);
+            error_out += (output[i + latency] - clean[i]) * (output[i + latency] - clean[i]);
+        }
+        test_assert(10.0 * log10(noise_in / noise_out) > 4.0, "Denoiser attenuates stationary noise");
+        test_assert(error_out < error_in, "Denoiser improves SNR with tone present");
+        
+        denoiser_free(denoiser);
+    }
+    
+    // Resampling parameters are ignored: the denoiser works at the input rate
+    STFTParameters resampled = params;
+    resampled.target_sample_rate = 32000.0;
+    float *reference = (float*)malloc(4096 * sizeof(float));
+    Denoiser *plain = denoiser_create(&params, NULL);
+    Denoiser *upsampled = denoiser_create(&resampled, NULL);
+    bool same = reference && plain && upsampled;
+    if (same) {
+        denoiser_process(plain, noisy, 4096, reference);
+        denoiser_process(upsampled, noisy, 4096, output);
+        same = memcmp(reference, output, 4096 * sizeof(float)) == 0;
+    }
+    test_assert(same, "Denoiser ignores target_sample_rate");
+    denoiser_free(plain);
+    denoiser_free(upsampled);
+    free(reference);
+    
+    STFTParameters invalid = params;
+    invalid.hop_size = 0;
+    test_assert(denoiser_create(&invalid, NULL) == NULL && denoiser_create(NULL, NULL) == NULL,
+                "Denoiser rejects invalid parameters");
+    
+    free(noisy);
+    free(clean);
+    free(output);
+}
+
+void test_energy_gate() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    
+    float *signal = generate_sine_wave(1000.0, 0.5, 1.0, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Gate test signal generation");
+    
+    if (signal) {
+        // First half silent
+        memset(signal, 0, (sample_count / 2) * sizeof(float));
+        
+        STFTParameters params = stft_create_parameters(512, 256, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+        STFTResult *ungated = perform_stft(signal, sample_count, &params);
+        params.energy_gate = true;
+        params.gate_threshold_db = -60.0;
+        STFTResult *gated = perform_stft(signal, sample_count, &params);
+        
+        test_assert(gated != NULL && gated->success, "Gated STFT computation");
+        test_assert(ungated != NULL && ungated->gated_frames == NULL && ungated->gated_frame_count == 0, "Gate off by default");
+        
+        if (gated && gated->success && ungated && ungated->success) {
+            int silent_frames = (sample_count / 2 - params.window_size) / params.hop_size + 1;
+            test_assert(gated->gated_frame_count == silent_frames, "Silent frames skipped");
+            test_assert(stft_frame_is_gated(gated, 0) && !stft_frame_is_gated(gated, gated->frame_count - 1), "Gate bitmap marks skipped frames");
+            
+            int mismatches = 0;
+            for (int frame = 0; frame < gated->frame_count; frame++) {
+                for (int bin = 0; bin < gated->frequency_bin_count; bin++) {
+                    kiss_fft_cpx a = gated->spectrogram_data[frame][bin];
+                    kiss_fft_cpx b = ungated->spectrogram_data[frame][bin];
+                    if (a.r != b.r || a.i != b.i) mismatches++;
+                }
+            }
+            test_assert(mismatches == 0, "Gated output matches ungated output");
+        }
+        
+        stft_free_result(gated);
+        stft_free_result(ungated);
+        free(signal);
+    }
+}
+
+void test_encoded_spectrogram() {
+    test_assert(stft_float_to_half(1.0f) == 0x3c00 && stft_float_to_half(-2.0f) == 0xc000, "Half conversion of exact values");
+    test_assert(stft_float_to_half(65504.0f) == 0x7bff && stft_float_to_half(65520.0f) == 0x7c00, "Half conversion overflow rounding");
+    test_assert(stft_float_to_half(ldexpf(1.0f, -24)) == 0x0001 && stft_half_to_float(0x0001) == ldexpf(1.0f, -24), "Half conversion subnormals");
+    test_assert(stft_float_to_bf16(1.0f) == 0x3f80 && stft_bf16_to_float(0x3f80) == 1.0f, "Bfloat16 conversion");
+    
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(1000.0, 0.5, 0.5, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Encoder test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(512, 256, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *result = perform_stft(signal, sample_count, &params);
+    float **reference = stft_get_power_spectrogram_db(result);
+    test_assert(reference != NULL, "Reference dB spectrogram");
+    
+    SpectrogramEncoding encodings[4] = { ENCODE_U8_DB, ENCODE_U16_DB, ENCODE_F16_DB, ENCODE_BF16_DB };
+    const char *names[4] = { "uint8 dB encoding", "uint16 dB encoding", "float16 dB encoding", "bfloat16 dB encoding" };
+    
+    for (int e = 0; e < 4 && reference; e++) {
+        EncodeOptions options = encode_default_options();
+        options.encoding = encodings[e];
+        options.min_db = -100.0f;
+        options.max_db = 0.0f;
+        
+        EncodedResult *encoded = perform_stft_encoded(signal, sample_count, &params, &options);
+        EncodedResult *converted = stft_encode_result(result, &options);
+        if (!encoded || !encoded->success || !converted || !converted->success) {
+            test_assert(false, names[e]);
+            encoded_free_result(encoded);
+            encoded_free_result(converted);
+            continue;
+        }
+        
+        size_t bytes = (size_t)encoded->frame_count * encoded->frequency_bin_count * encode_element_size(options.encoding);
+        bool same = encoded->frame_count == result->frame_count && memcmp(encoded->data, converted->data, bytes) == 0;
+        
+        float *row = (float*)malloc(encoded->frequency_bin_count * sizeof(float));
+        float max_error = 0.0f;
+        for (int frame = 0; frame < encoded->frame_count && row; frame++) {
+            size_t offset = (size_t)frame * encoded->frequency_bin_count * encode_element_size(options.encoding);
+            decode_power_db_row((const uint8_t*)encoded->data + offset, encoded->frequency_bin_count, &options, row);
+            for (int bin = 0; bin < encoded->frequency_bin_count; bin++) {
+                float expected = reference[frame][bin];
+                if (options.encoding == ENCODE_U8_DB || options.encoding == ENCODE_U16_DB) {
+                    expected = fminf(fmaxf(expected, options.min_db), options.max_db);
+                }
+                float error = fabsf(row[bin] - expected);
+                if (error > max_error) max_error = error;
+            }
+        }
+        free(row);
+        
+        // Half a quantization step, or the relative precision of the float format at |dB| <= ~400
+        float tolerance[4] = { 100.0f / 255.0f * 0.5f + 1e-3f, 100.0f / 65535.0f * 0.5f + 1e-3f, 0.25f, 1.0f };
+        test_assert(same && max_error <= tolerance[e], names[e]);
+        
+        encoded_free_result(encoded);
+        encoded_free_result(converted);
+    }
+    
+    stft_free_2d_array(reference, result ? result->frame_count : 0);
+    stft_free_result(result);
+    free(signal);
+}
+
+void test_fast_accuracy() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(1000.0, 0.5, 0.5, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Accuracy test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(512, 256, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *exact = perform_stft(signal, sample_count, &params);
+    params.accuracy = ACCURACY_FAST;
+    STFTResult *fast = perform_stft(signal, sample_count, &params);
+    test_assert(exact && fast && exact->accuracy == ACCURACY_EXACT && fast->accuracy == ACCURACY_FAST, "Accuracy mode recorded on result");
+    
+    if (exact && fast) {
+        float **outputs[2][3] = {
+            { stft_get_power_spectrogram_db(exact), stft_get_phase_spectrogram(exact), stft_get_magnitude_spectrogram(exact) },
+            { stft_get_power_spectrogram_db(fast), stft_get_phase_spectrogram(fast), stft_get_magnitude_spectrogram(fast) }
+        };
+        double max_error[3] = { 0.0, 0.0, 0.0 };
+        
+        for (int k = 0; k < 3; k++) {
+            if (!outputs[0][k] || !outputs[1][k]) {
+                max_error[k] = INFINITY;
+                continue;
+            }
+            for (int frame = 0; frame < exact->frame_count; frame++) {
+                for (int bin = 0; bin < exact->frequency_bin_count; bin++) {
+                    double a = outputs[0][k][frame][bin];
+                    double b = outputs[1][k][frame][bin];
+                    double error = k == 2 ? fabs(a - b) / fmax(a, 1e-30) : fabs(a - b);
+                    // Phase wraps at +-pi
+                    if (k == 1 && error > M_PI) error = 2.0 * M_PI - error;
+                    if (error > max_error[k]) max_error[k] = error;
+                }
+            }
+        }
+        
+        test_assert(max_error[0] < 5e-5, "Fast power dB within 5e-5 dB");
+        test_assert(max_error[1] < 2e-6, "Fast phase within 2e-6 rad");
+        test_assert(max_error[2] < 3e-7, "Fast magnitude within 3e-7 relative");
+        
+        for (int a = 0; a < 2; a++) {
+            for (int k = 0; k < 3; k++) {
+                stft_free_2d_array(outputs[a][k], exact->frame_count);
+            }
+        }
+    }
+    
+    stft_free_result(exact);
+    stft_free_result(fast);
+    free(signal);
+}
+
+void test_bin_major_layout() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(440.0, 0.5, 0.37, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Layout test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(400, 160, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *frames = perform_stft(signal, sample_count, &params);
+    params.layout = LAYOUT_BIN_MAJOR;
+    STFTResult *bins = perform_stft(signal, sample_count, &params);
+    
+    test_assert(bins && bins->success && bins->layout == LAYOUT_BIN_MAJOR && bins->spectrogram_data == NULL, "Bin-major STFT computation");
+    test_assert(frames && bins && frames->frame_count % 16 != 0, "Layout test covers a partial transpose block");
+    
+    if (frames && frames->success && bins && bins->success) {
+        int mismatches = 0;
+        for (int bin = 0; bin < bins->frequency_bin_count; bin++) {
+            const kiss_fft_cpx *series = stft_get_bin_series(bins, bin);
+            for (int frame = 0; series && frame < bins->frame_count; frame++) {
+                kiss_fft_cpx expected = frames->spectrogram_data[frame][bin];
+                if (series[frame].r != expected.r || series[frame].i != expected.i) mismatches++;
+            }
+            if (!series) mismatches++;
+        }
+        test_assert(mismatches == 0, "Bin series match frame-major spectrogram");
+        test_assert(stft_get_bin_series(frames, 0) == NULL, "Frame-major result has no bin series");
+        
+        float **db_frames = stft_get_power_spectrogram_db(frames);
+        float **db_bins = stft_get_power_spectrogram_db(bins);
+        bool same_db = db_frames && db_bins;
+        for (int frame = 0; same_db && frame < frames->frame_count; frame++) {
+            same_db = memcmp(db_frames[frame], db_bins[frame], frames->frequency_bin_count * sizeof(float)) == 0;
+        }
+        test_assert(same_db, "Getters are layout independent");
+        stft_free_2d_array(db_frames, frames->frame_count);
+        stft_free_2d_array(db_bins, bins->frame_count);
+        
+        int length_frames, length_bins;
+        float *out_frames = perform_istft(frames, &params, &length_frames);
+        float *out_bins = perform_istft(bins, &params, &length_bins);
+        test_assert(out_frames && out_bins && length_frames == length_bins &&
+                    memcmp(out_frames, out_bins, length_frames * sizeof(float)) == 0, "ISTFT of bin-major result");
+        free(out_frames);
+        free(out_bins);
+    }
+    
+    stft_free_result(frames);
+    stft_free_result(bins);
+    free(signal);
+}
+
+void test_split_complex_format() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(440.0, 0.5, 0.37, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Split format test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(400, 160, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *reference = perform_stft(signal, sample_count, &params);
+    
+    for (int layout = 0; layout < 2 && reference && reference->success; layout++) {
+        params.layout = layout == 0 ? LAYOUT_FRAME_MAJOR : LAYOUT_BIN_MAJOR;
+        params.format = COMPLEX_SPLIT;
+        STFTResult *split = perform_stft(signal, sample_count, &params);
+        
+        bool ok = split && split->success && split->format == COMPLEX_SPLIT &&
+                  split->spectrogram_data == NULL && split->bin_major_data == NULL &&
+                  ((uintptr_t)split->real_data % 64) == 0 && ((uintptr_t)split->imag_data % 64) == 0 &&
+                  split->plane_stride % 16 == 0;
+        
+        for (int frame = 0; ok && frame < reference->frame_count; frame++) {
+            for (int bin = 0; bin < reference->frequency_bin_count; bin++) {
+                size_t index = layout == 0 ? (size_t)frame * split->plane_stride + bin
+                                           : (size_t)bin * split->plane_stride + frame;
+                kiss_fft_cpx expected = reference->spectrogram_data[frame][bin];
+                if (split->real_data[index] != expected.r || split->imag_data[index] != expected.i) ok = false;
+            }
+        }
+        
+        float **db = ok ? stft_get_power_spectrogram_db(split) : NULL;
+        float **db_reference = stft_get_power_spectrogram_db(reference);
+        for (int frame = 0; db && db_reference && frame < reference->frame_count; frame++) {
+            if (memcmp(db[frame], db_reference[frame], reference->frequency_bin_count * sizeof(float)) != 0) ok = false;
+        }
+        ok = ok && db != NULL;
+        stft_free_2d_array(db, reference->frame_count);
+        stft_free_2d_array(db_reference, reference->frame_count);
+        
+        test_assert(ok, layout == 0 ? "Split planes, frame-major" : "Split planes, bin-major");
+        stft_free_result(split);
+    }
+    
+    stft_free_result(reference);
+    free(signal);
+}
+
+typedef struct {
+    int allocations;
+    int frees;
+    size_t bytes;
+} CountingContext;
+
+static void* counting_alloc(void *ctx, size_t size) {
+    CountingContext *counts = (CountingContext*)ctx;
+    counts->allocations++;
+    counts->bytes += size;
+    return malloc(size);
+}
+
+static void counting_free(void *ctx, void *ptr) {
+    ((CountingContext*)ctx)->frees++;
+    free(ptr);
+}
+
+void test_plan_allocators() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(440.0, 0.5, 1.0, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Allocator test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *reference = perform_stft(signal, sample_count, &params);
+    
+    // Every allocation goes through the vtable and a result costs a fixed number of them
+    CountingContext counts = { 0, 0, 0 };
+    STFTAllocator counting = { counting_alloc, counting_free, NULL, &counts };
+    STFTPlan *plan = stft_plan_create(&params, &counting);
+    test_assert(plan != NULL && counts.allocations > 0, "Plan allocates through custom allocator");
+    
+    int plan_allocations = counts.allocations;
+    STFTResult *result = plan ? stft_plan_execute(plan, signal, sample_count) : NULL;
+    test_assert(result && result->success && counts.allocations - plan_allocations <= 4, "Plan execution uses O(1) allocations");
+    
+    bool same = result && reference && result->frame_count == reference->frame_count;
+    for (int frame = 0; same && frame < reference->frame_count; frame++) {
+        same = memcmp(result->spectrogram_data[frame], reference->spectrogram_data[frame],
+                      reference->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+    }
+    test_assert(same, "Plan output matches perform_stft");
+    
+    float **db = stft_get_power_spectrogram_db(result);
+    stft_result_free_2d_array(result, db);
+    stft_free_result(result);
+    stft_plan_destroy(plan);
+    test_assert(counts.allocations == counts.frees, "Custom allocator sees every free");
+    
+    // Arena: the first job sizes the arena, later jobs after a reset fit in one block
+    STFTArena *arena = stft_arena_create(4096, NULL);
+    STFTAllocator arena_allocator = stft_arena_allocator(arena);
+    plan = stft_plan_create(&params, &arena_allocator);
+    result = plan ? stft_plan_execute(plan, signal, sample_count) : NULL;
+    test_assert(result && result->success && ((uintptr_t)result % 16) == 0, "Plan executes from arena");
+    
+    stft_arena_reset(arena);
+    size_t capacity = stft_arena_capacity(arena);
+    plan = stft_plan_create(&params, &arena_allocator);
+    result = plan ? stft_plan_execute(plan, signal, sample_count) : NULL;
+    same = result && reference && result->success;
+    for (int frame = 0; same && frame < reference->frame_count; frame++) {
+        same = memcmp(result->spectrogram_data[frame], reference->spectrogram_data[frame],
+                      reference->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+    }
+    test_assert(same && stft_arena_capacity(arena) == capacity && stft_arena_bytes_used(arena) <= capacity,
+                "Arena reset reuses one block for the next job");
+    
+    stft_arena_destroy(arena);
+    stft_free_result(reference);
+    free(signal);
+}
+
+void test_parallel_execution() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(440.0, 0.5, 2.0, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Parallel test signal generation");
+    if (!signal) return;
+    
+    // Each frame is computed independently, so every thread count gives bit-identical output
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    params.energy_gate = true;
+    params.gate_threshold_db = -20.0f;
+    for (int i = sample_count / 3; i < sample_count / 2; i++) signal[i] = 0.0f;
+    
+    bool ok = true;
+    for (int variant = 0; variant < 4; variant++) {
+        params.layout = (variant & 1) ? LAYOUT_BIN_MAJOR : LAYOUT_FRAME_MAJOR;
+        params.format = (variant & 2) ? COMPLEX_SPLIT : COMPLEX_INTERLEAVED;
+        params.thread_count = 1;
+        params.memory_hints = MEMORY_DEFAULT;
+        STFTResult *serial = perform_stft(signal, sample_count, &params);
+    
+        params.thread_count = 4;
+        params.memory_hints = variant == 3 ? MEMORY_HUGE_PAGES | MEMORY_NUMA_LOCAL : MEMORY_NUMA_LOCAL;
+        STFTResult *parallel = perform_stft(signal, sample_count, &params);
+    
+        bool same = serial && parallel && serial->success && parallel->success &&
+                    serial->gated_frame_count > 0 && serial->gated_frame_count == parallel->gated_frame_count &&
+                    memcmp(serial->gated_frames, parallel->gated_frames, (serial->frame_count + 7) / 8) == 0;
+        kiss_fft_cpx *a = same ? malloc(serial->frequency_bin_count * sizeof(kiss_fft_cpx)) : NULL;
+        kiss_fft_cpx *b = same ? malloc(serial->frequency_bin_count * sizeof(kiss_fft_cpx)) : NULL;
+        for (int frame = 0; a && b && same && frame < serial->frame_count; frame++) {
+            same = memcmp(stft_get_frame(serial, frame, a), stft_get_frame(parallel, frame, b),
+                          serial->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+        }
+        ok = ok && same && a && b;
+        free(a);
+        free(b);
+        stft_free_result(serial);
+        stft_free_result(parallel);
+    }
+    test_assert(ok, "Threaded plans match single-threaded output for every layout");
+    
+    // A reused threaded plan gives the same answer on every run
+    params.layout = LAYOUT_FRAME_MAJOR;
+    params.format = COMPLEX_INTERLEAVED;
+    STFTPlan *plan = stft_plan_create(&params, NULL);
+    STFTResult *first = plan ? stft_plan_execute(plan, signal, sample_count) : NULL;
+    STFTResult *second = plan ? stft_plan_execute(plan, signal, sample_count) : NULL;
+    bool same = first && second && first->success && second->success;
+    for (int frame = 0; same && frame < first->frame_count; frame++) {
+        same = memcmp(first->spectrogram_data[frame], second->spectrogram_data[frame],
+                      first->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+    }
+    test_assert(same, "Threaded plan is repeatable");
+    stft_free_result(first);
+    stft_free_result(second);
+    stft_plan_destroy(plan);
+    
+    // Huge-page blocks are 64-byte aligned and writable end to end
+    const STFTAllocator *huge = stft_huge_page_allocator();
+    size_t sizes[2] = { 1000, 3u << 20 };
+    for (int i = 0; i < 2; i++) {
+        unsigned char *block = huge->alloc(huge->ctx, sizes[i]);
+        test_assert(block != NULL && ((uintptr_t)block % 64) == 0, i == 0 ? "Huge-page allocator small block" : "Huge-page allocator large block");
+        if (block) {
+            memset(block, 0xab, sizes[i]);
+            huge->free(huge->ctx, block);
+        }
+    }
+    
+    free(signal);
+}
+
+void test_batch_processing() {
+    double sample_rate = 16000.0;
+    int long_count;
+    float *long_signal = generate_sine_wave(440.0, 0.5, 3.0, sample_rate, &long_count);
+    test_assert(long_signal != NULL, "Batch test signal generation");
+    if (!long_signal) return;
+    
+    STFTParameters frame_major = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTParameters bin_major = stft_create_parameters(256, 64, sample_rate, WINDOW_HANN, SCALING_PSD);
+    bin_major.layout = LAYOUT_BIN_MAJOR;
+    STFTParameters invalid = stft_create_parameters(256, 512, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    
+    // One long file, many short clips of varying length, a second parameter set and a bad job
+    enum { JOB_COUNT = 40 };
+    STFTBatchJob jobs[JOB_COUNT];
+    for (int j = 0; j < JOB_COUNT; j++) {
+        int length = j == 0 ? long_count : 600 + (j * 997) % 4000;
+        jobs[j] = (STFTBatchJob){ long_signal + (j * 131) % 1000, length - 1000 > 512 ? length - 1000 : length,
+                                  j % 3 == 2 ? &bin_major : &frame_major };
+    }
+    jobs[JOB_COUNT - 1].params = &invalid;
+    
+    BatchOptions options = batch_default_options();
+    options.thread_count = 4;
+    options.target_frames = 40;
+    BatchResult *batch = perform_stft_batch(jobs, JOB_COUNT, &options);
+    test_assert(batch && batch->success && batch->job_count == JOB_COUNT && batch->failed_count == 1,
+                "Batch runs every job and reports the bad one");
+    
+    bool same = batch && batch->success;
+    kiss_fft_cpx a[257], b[257];
+    for (int j = 0; same && j < JOB_COUNT - 1; j++) {
+        STFTResult *reference = perform_stft(jobs[j].input_data, jobs[j].input_length, jobs[j].params);
+        STFTResult *batched = batch->results[j];
+        same = reference && reference->success && batched->success && batched->layout == reference->layout &&
+               batched->frame_count == reference->frame_count;
+        for (int frame = 0; same && frame < reference->frame_count; frame++) {
+            same = memcmp(stft_get_frame(reference, frame, a), stft_get_frame(batched, frame, b),
+                          reference->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+        }
+        stft_free_result(reference);
+    }
+    test_assert(same, "Batch output matches perform_stft per job");
+    test_assert(batch && !batch->results[JOB_COUNT - 1]->success && batch->results[JOB_COUNT - 1]->message,
+                "Invalid batch job carries its error");
+    
+    batch_free_result(batch);
+    
+    // One worker runs both jobs; PSD scaling differs with the rate, so its engine must be rebuilt
+    STFTParameters psd_low = stft_create_parameters(512, 256, 16000.0, WINDOW_HANN, SCALING_PSD);
+    STFTParameters psd_high = stft_create_parameters(512, 256, 44100.0, WINDOW_HANN, SCALING_PSD);
+    STFTBatchJob rate_jobs[2] = { { long_signal, 8000, &psd_low }, { long_signal, 8000, &psd_high } };
+    BatchOptions serial = { 1, 256 };
+    BatchResult *mixed = perform_stft_batch(rate_jobs, 2, &serial);
+    same = mixed && mixed->success && mixed->failed_count == 0;
+    for (int j = 0; same && j < 2; j++) {
+        STFTResult *reference = perform_stft(long_signal, 8000, rate_jobs[j].params);
+        same = reference && reference->success && reference->frame_count == mixed->results[j]->frame_count;
+        for (int frame = 0; same && frame < reference->frame_count; frame++) {
+            same = memcmp(reference->spectrogram_data[frame], mixed->results[j]->spectrogram_data[frame],
+                          reference->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+        }
+        stft_free_result(reference);
+    }
+    test_assert(same, "Batch rebuilds engines for jobs at different rates");
+    batch_free_result(mixed);
+    free(long_signal);
+}
+
+void test_realtime_ring() {
+    // Odd-sized writes and reads wrap around the power-of-two ring in order
+    STFTRing *ring = stft_ring_create(100, sizeof(int));
+    test_assert(ring != NULL && stft_ring_capacity(ring) == 128, "Ring capacity rounds up to a power of two");
+    bool ordered = ring != NULL;
+    int next_write = 0, next_read = 0;
+    int buffer[77];
+    for (int round = 0; ordered && round < 50; round++) {
+        int count = 13 + (round * 29) % 64;
+        for (int i = 0; i < count; i++) buffer[i] = next_write + i;
+        next_write += (int)stft_ring_write(ring, buffer, count);
+        size_t taken = stft_ring_read(ring, buffer, 77);
+        for (size_t i = 0; i < taken; i++) {
+            if (buffer[i] != next_read++) ordered = false;
+        }
+    }
+    test_assert(ordered && stft_ring_write_available(ring) + stft_ring_read_available(ring) == 128, "Ring keeps FIFO order across wrap-around");
+    stft_ring_free(ring);
+    
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_time_varying_signal(sample_rate, 0.5, &sample_count);
+    test_assert(signal != NULL, "Real-time test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *reference = perform_stft(signal, sample_count, &params);
+    STFTRealtime *realtime = stft_realtime_create(&params, 1 << 14, 64);
+    test_assert(realtime != NULL && stft_realtime_bin_count(realtime) == 257, "Real-time bridge creation");
+    
+    // Audio-sized pushes; the consumer drains frames as they arrive
+    kiss_fft_cpx bins[257];
+    StreamCheck check = { reference, 0, 0 };
+    int pushed = 0;
+    for (int spin = 0; realtime && reference && check.frames < reference->frame_count && spin < 200000; spin++) {
+        if (pushed < sample_count) {
+            int count = sample_count - pushed < 256 ? sample_count - pushed : 256;
+            pushed += stft_realtime_push(realtime, signal + pushed, count);
+        }
+        STFTFrame frame;
+        if (stft_realtime_pop_frame(realtime, bins, &frame)) {
+            compare_stream_frame(&frame, &check);
+        } else {
+            struct timespec pause = { 0, 50000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+    STFTRealtimeStats stats = realtime ? stft_realtime_stats(realtime) : (STFTRealtimeStats){ 0 };
+    test_assert(reference && check.frames == reference->frame_count && check.mismatches == 0,
+                "Real-time bridge frames match batch STFT");
+    test_assert(stats.samples_pushed == (uint64_t)sample_count && stats.samples_dropped == 0 && stats.frames_dropped == 0,
+                "Real-time bridge counters without overrun");
+    stft_realtime_free(realtime);
+    
+    // Nobody consumes: the frame ring fills and the rest are counted as dropped
+    realtime = stft_realtime_create(&params, 1 << 14, 4);
+    for (int offset = 0; realtime && offset < sample_count; offset += 256) {
+        int count = sample_count - offset < 256 ? sample_count - offset : 256;
+        while (stft_realtime_push(realtime, signal + offset, count) == 0) {
+            struct timespec pause = { 0, 50000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+    for (int spin = 0; realtime && spin < 20000; spin++) {
+        stats = stft_realtime_stats(realtime);
+        if (reference && stats.frames_published + stats.frames_dropped == (uint64_t)reference->frame_count) break;
+        struct timespec pause = { 0, 50000 };
+        nanosleep(&pause, NULL);
+    }
+    test_assert(realtime && stats.frames_published == 4 && stats.frames_dropped > 0, "Real-time bridge counts frame overruns");
+    test_assert(realtime && stft_realtime_pop_frame(realtime, bins, NULL) == 1 && stft_realtime_stats(realtime).underruns == 0,
+                "Real-time bridge keeps the oldest frames");
+    stft_realtime_free(realtime);
+    
+    stft_free_result(reference);
+    free(signal);
+}
+
+static void count_completion(STFTJob *job, STFTResult *result, void *user_data) {
+    (void)job;
+    if (result && result->success) __atomic_fetch_add((int*)user_data, 1, __ATOMIC_RELAXED);
+}
+
+void test_async_jobs() {
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_sine_wave(440.0, 0.5, 1.0, sample_rate, &sample_count);
+    test_assert(signal != NULL, "Async test signal generation");
+    if (!signal) return;
+    
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTParameters wide = stft_create_parameters(1024, 256, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *reference = perform_stft(signal, sample_count, &params);
+    STFTPlan *plans[2] = { stft_plan_create(&params, NULL), stft_plan_create(&wide, NULL) };
+    
+    // Several jobs per plan: same-plan jobs are serialised, different plans overlap
+    enum { JOBS = 8 };
+    STFTJob *jobs[JOBS];
+    STFTResult *outputs[JOBS] = { 0 };
+    int completions = 0;
+    for (int j = 0; j < JOBS; j++) {
+        jobs[j] = stft_submit(plans[j % 2], signal, sample_count - j * 100, &outputs[j], count_completion, &completions);
+    }
+    
+    bool ok = reference && reference->success;
+    for (int j = 0; j < JOBS; j++) {
+        STFTResult *result = jobs[j] ? stft_job_wait(jobs[j]) : NULL;
+        ok = ok && result && result->success && result == outputs[j] && stft_job_poll(jobs[j]);
+        if (ok && j % 2 == 0) {
+            for (int frame = 0; ok && frame < result->frame_count; frame++) {
+                ok = memcmp(result->spectrogram_data[frame], reference->spectrogram_data[frame],
+                            reference->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+            }
+        }
+        stft_job_release(jobs[j]);
+        stft_free_result(outputs[j]);
+    }
+    test_assert(ok && __atomic_load_n(&completions, __ATOMIC_RELAXED) == JOBS, "Async jobs complete with callbacks and match perform_stft");
+    
+    // The eventfd becomes readable when the job finishes, even if asked for afterwards
+    STFTResult *out = NULL;
+    STFTJob *job = stft_submit(plans[0], signal, sample_count, &out, NULL, NULL);
+    int fd = job ? stft_job_eventfd(job) : -1;
+    stft_job_wait(job);
+    uint64_t count = 0;
+    bool readable = fd < 0 || read(fd, &count, sizeof(count)) == (ssize_t)sizeof(count);
+    test_assert(job && out && out->success && readable, "Async job signals its eventfd");
+    stft_job_release(job);
+    stft_free_result(out);
+    
+    // A handle released early still runs; shutdown drains it
+    out = NULL;
+    stft_job_release(stft_submit(plans[1], signal, sample_count, &out, NULL, NULL));
+    stft_async_shutdown();
+    test_assert(out && out->success, "Released async job still completes");
+    stft_free_result(out);
+    
+    stft_plan_destroy(plans[0]);
+    stft_plan_destroy(plans[1]);
+    stft_free_result(reference);
+    free(signal);
+}
+
+typedef struct {
+    STFTResult *reference;
+    int mismatches;
+} PipelineCheck;
+
+static void compare_pipelined_frame(const STFTFrame *frame, void *user_data) {
+    PipelineCheck *check = (PipelineCheck*)user_data;
+    if (memcmp(frame->bins, check->reference->spectrogram_data[frame->index], frame->bin_count * sizeof(kiss_fft_cpx)) != 0) {
+        check->mismatches++;
+    }
+}
+
+void test_pipelined_frame_loop() {
+    // Large enough (> 8 MB of output) for the non-temporal store path
+    double sample_rate = 16000.0;
+    int sample_count;
+    float *signal = generate_time_varying_signal(sample_rate, 40.0, &sample_count);
+    test_assert(signal != NULL, "Pipeline test signal generation");
+    if (!signal) return;
+    for (int i = sample_count / 2; i < sample_count / 2 + 16000; i++) signal[i] = 0.0f;
+    
+    STFTParameters params = stft_create_parameters(512, 128, sample_rate, WINDOW_HANN, SCALING_SPECTRUM);
+    params.energy_gate = true;
+    params.gate_threshold_db = -40.0f;
+    STFTResult *result = perform_stft(signal, sample_count, &params);
+    test_assert(result && result->success && (size_t)result->frame_count * result->frequency_bin_count * sizeof(kiss_fft_cpx) > ((size_t)8 << 20),
+                "Pipelined STFT on a large input");
+    
+    // The callback loop computes every frame the unpipelined way
+    PipelineCheck check = { result, 0 };
+    char *error = result ? stft_process_frames(signal, sample_count, &params, compare_pipelined_frame, &check) : strdup("no result");
+    test_assert(error == NULL && check.mismatches == 0 && result->gated_frame_count > 0, "Pipelined frame loop matches the callback loop");
+    free(error);
+    
+    stft_free_result(result);
+    free(signal);
+}
+
+void test_inplace_fft() {
+    // 77 = 7 * 11 runs only generic butterflies; 512 only the fixed radices
+    const int sizes[] = { 512, 77 };
+    for (int s = 0; s < 2; s++) {
+        int n = sizes[s];
+        size_t cfg_size = 0;
+        kiss_fft_alloc(n, 0, NULL, &cfg_size);
+        void *cfg_memory = malloc(cfg_size);
+        kiss_fft_cfg cfg = kiss_fft_alloc(n, 0, cfg_memory, &cfg_size);
+        kiss_fft_cpx *input = malloc(n * sizeof(kiss_fft_cpx));
+        kiss_fft_cpx *output = malloc(n * sizeof(kiss_fft_cpx));
+        test_assert(cfg && input && output, "In-place FFT setup");
+        if (!cfg || !input || !output) {
+            free(cfg_memory);
+            free(input);
+            free(output);
+            return;
+        }
+    
+        for (int i = 0; i < n; i++) {
+            input[i].r = sinf(0.37f * i) + 0.25f * (float)(i % 5);
+            input[i].i = cosf(0.11f * i * i);
+        }
+        kiss_fft(cfg, input, output);
+    
+        // Against a direct DFT
+        double max_error = 0.0;
+        for (int k = 0; k < n; k++) {
+            double re = 0.0, im = 0.0;
+            for (int i = 0; i < n; i++) {
+                double phase = -2.0 * M_PI * (double)((long)k * i % n) / n;
+                re += input[i].r * cos(phase) - input[i].i * sin(phase);
+                im += input[i].r * sin(phase) + input[i].i * cos(phase);
+            }
+            double error = fabs(re - output[k].r) + fabs(im - output[k].i);
+            if (error > max_error) max_error = error;
+        }
+    
+        kiss_fft(cfg, input, input);
+        bool same = memcmp(input, output, n * sizeof(kiss_fft_cpx)) == 0;
+        char name[64];
+        snprintf(name, sizeof(name), "In-place FFT of size %d matches out-of-place", n);
+        test_assert(same && max_error < 1e-3, name);
+    
+        free(cfg_memory);
+        free(input);
+        free(output);
+    }
+}
+
+void test_four_step_fft() {
+    // Above the four-step threshold: 2^19 splits 512 x 1024, 3 * 2^18 splits 768 x 1024
+    const int sizes[] = { 1 << 19, 3 << 18 };
+    const int tones[] = { 3, 1000, 77777 };
+    for (int s = 0; s < 2; s++) {
+        int n = sizes[s];
+        kiss_fft_cfg forward = kiss_fft_alloc(n, 0, NULL, NULL);
+        kiss_fft_cfg inverse = kiss_fft_alloc(n, 1, NULL, NULL);
+        kiss_fft_cpx *input = malloc(n * sizeof(kiss_fft_cpx));
+        kiss_fft_cpx *output = malloc(n * sizeof(kiss_fft_cpx));
+        test_assert(forward && inverse && input && output, "Four-step FFT setup");
+        if (!forward || !inverse || !input || !output) {
+            free(forward);
+            free(inverse);
+            free(input);
+            free(output);
+            return;
+        }
+    
+        // Complex tones on exact bins transform to spikes of height n
+        for (int i = 0; i < n; i++) {
+            input[i].r = 0.0f;
+            input[i].i = 0.0f;
+            for (int t = 0; t < 3; t++) {
+                double phase = 2.0 * M_PI * (double)((long)tones[t] * i % n) / n;
+                input[i].r += (float)((t + 1) * cos(phase));
+                input[i].i += (float)((t + 1) * sin(phase));
+            }
+        }
+        kiss_fft(forward, input, output);
+        double max_error = 0.0;
+        for (int k = 0; k < n; k++) {
+            double expected = 0.0;
+            for (int t = 0; t < 3; t++) {
+                if (k == tones[t]) expected = (double)(t + 1) * n;
+            }
+            double error = fabs(output[k].r - expected) + fabs(output[k].i);
+            if (error > max_error) max_error = error;
+        }
+    
+        // In place, then back through the inverse
+        kiss_fft_cpx first = input[1];
+        kiss_fft(forward, input, input);
+        bool same = memcmp(input, output, n * sizeof(kiss_fft_cpx)) == 0;
+        kiss_fft(inverse, input, input);
+        double round_trip = fabs(input[1].r / n - first.r) + fabs(input[1].i / n - first.i);
+    
+        char name[64];
+        snprintf(name, sizeof(name), "Four-step FFT of size %d", n);
+        test_assert(max_error < 1e-4 * n && same && round_trip < 1e-3, name);
+    
+        free(forward);
+        free(inverse);
+        free(input);
+        free(output);
+    }
+}
+
+void test_intra_fft_parallelism() {
+    // Fewer frames than workers: the plan splits each FFT over its pool instead
+    const int windows[] = { 1 << 16, 3 << 15 };
+    for (int w = 0; w < 2; w++) {
+        int window = windows[w];
+        int sample_count = window + window / 2;
+        float *signal = malloc(sample_count * sizeof(float));
+        test_assert(signal != NULL, "Intra-FFT test signal allocation");
+        if (!signal) return;
+        for (int i = 0; i < sample_count; i++) {
+            signal[i] = sinf(0.013f * i) + 0.3f * sinf(0.71f * i + 0.002f * i * (i % 7));
+        }
+    
+        STFTParameters params = stft_create_parameters(window, window / 4, 48000.0, WINDOW_HANN, SCALING_SPECTRUM);
+        STFTResult *serial = perform_stft(signal, sample_count, &params);
+        params.thread_count = 8;
+        STFTResult *parallel = perform_stft(signal, sample_count, &params);
+    
+        bool same = serial && parallel && serial->success && parallel->success &&
+                    parallel->frame_count == 3 && parallel->frame_count == serial->frame_count;
+        for (int frame = 0; same && frame < serial->frame_count; frame++) {
+            same = memcmp(serial->spectrogram_data[frame], parallel->spectrogram_data[frame],
+                          serial->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "Intra-FFT parallel window %d matches serial", window);
+        test_assert(same, name);
+    
+        stft_free_result(serial);
+        stft_free_result(parallel);
+        free(signal);
+    }
+}
+
+void test_radix8_fft() {
+    // Power-of-two sizes factor into radix-8 stages plus at most two radix-4 ones
+    const int sizes[] = { 8, 16, 32, 64, 128, 2048 };
+    double max_error = 0.0;
+    for (int s = 0; s < 6; s++) {
+        int n = sizes[s];
+        for (int inverse = 0; inverse < 2; inverse++) {
+            kiss_fft_cfg cfg = kiss_fft_alloc(n, inverse, NULL, NULL);
+            kiss_fft_cpx *input = malloc(n * sizeof(kiss_fft_cpx));
+            kiss_fft_cpx *output = malloc(n * sizeof(kiss_fft_cpx));
+            if (!cfg || !input || !output) {
+                max_error = INFINITY;
+                free(cfg);
+                free(input);
+                free(output);
+                continue;
+            }
+            for (int i = 0; i < n; i++) {
+                input[i].r = cosf(0.9f * i) - 0.5f * (float)(i % 3);
+                input[i].i = sinf(0.05f * i * i);
+            }
+            kiss_fft(cfg, input, output);
+    
+            double sign = inverse ? 1.0 : -1.0;
+            for (int k = 0; k < n; k++) {
+                double re = 0.0, im = 0.0;
+                for (int i = 0; i < n; i++) {
+                    double phase = sign * 2.0 * M_PI * (double)((long)k * i % n) / n;
+                    re += input[i].r * cos(phase) - input[i].i * sin(phase);
+                    im += input[i].r * sin(phase) + input[i].i * cos(phase);
+                }
+                double error = (fabs(re - output[k].r) + fabs(im - output[k].i)) / n;
+                if (error > max_error) max_error = error;
+            }
+            free(cfg);
+            free(input);
+            free(output);
+        }
+    }
+    test_assert(max_error < 1e-5, "Radix-8 FFTs match a direct DFT");
+}
+
+void test_real_fft_windowing() {
+    // Even windows run the packed real FFT, odd ones the complex fallback; both against a direct DFT
+    const int windows[] = { 256, 255, 1000 };
+    for (int w = 0; w < 3; w++) {
+        int window_size = windows[w];
+        int sample_count = window_size * 3;
+        float *signal = malloc(sample_count * sizeof(float));
+        float *window = generate_hann_window(window_size);
+        STFTParameters params = stft_create_parameters(window_size, window_size / 2, 8000.0, WINDOW_HANN, SCALING_SPECTRUM);
+        STFTResult *result = NULL;
+        if (signal && window) {
+            for (int i = 0; i < sample_count; i++) {
+                signal[i] = sinf(0.3f * i) + 0.2f * (float)((i * 37) % 11) - 1.0f;
+            }
+            result = perform_stft(signal, sample_count, &params);
+        }
+    
+        double max_error = INFINITY;
+        if (result && result->success) {
+            int frame = 2;
+            const float *samples = signal + frame * params.hop_size;
+            double window_sum = 0.0, peak = 0.0;
+            for (int i = 0; i < window_size; i++) window_sum += window[i];
+            max_error = 0.0;
+            for (int k = 0; k < result->frequency_bin_count; k++) {
+                double re = 0.0, im = 0.0;
+                for (int i = 0; i < window_size; i++) {
+                    double phase = -2.0 * M_PI * (double)((long)k * i % window_size) / window_size;
+                    re += samples[i] * window[i] * cos(phase);
+                    im += samples[i] * window[i] * sin(phase);
+                }
+                re /= window_sum * window_sum;
+                im /= window_sum * window_sum;
+                double error = fabs(re - result->spectrogram_data[frame][k].r) + fabs(im - result->spectrogram_data[frame][k].i);
+                if (error > max_error) max_error = error;
+                if (fabs(re) + fabs(im) > peak) peak = fabs(re) + fabs(im);
+            }
+            max_error /= peak;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "Windowed FFT of size %d matches a direct DFT", window_size);
+        test_assert(max_error < 1e-5, name);
+    
+        stft_free_result(result);
+        free(window);
+        free(signal);
+    }
+}
+
+typedef struct {
+    const STFTResult *reference;
+    int frames;
+    double max_error;
+} ResampledStreamCheck;
+
+static void compare_resampled_frame(const STFTFrame *frame, void *user_data) {
+    ResampledStreamCheck *check = (ResampledStreamCheck*)user_data;
+    check->frames++;
+    if (frame->index >= check->reference->frame_count) {
+        check->max_error = INFINITY;
+        return;
+    }
+    for (int k = 0; k < frame->bin_count; k++) {
+        const kiss_fft_cpx expected = check->reference->spectrogram_data[frame->index][k];
+        double error = fabs(expected.r - frame->bins[k].r) + fabs(expected.i - frame->bins[k].i);
+        if (error > check->max_error) check->max_error = error;
+    }
+}
+
+void test_resampling_front_end() {
+    // 48 kHz in, decimated by 6: 1 kHz is in band, 10 kHz would alias onto 2 kHz if not filtered
+    int sample_count = 48000;
+    float *signal = malloc(sample_count * sizeof(float));
+    float *direct = malloc(8000 * sizeof(float));
+    float *ones = malloc(4000 * sizeof(float));
+    STFTResampler *resampler = stft_resampler_create(160, 147, NULL);
+    if (!signal || !direct || !ones || !resampler) {
+        test_assert(0, "Resampling test setup");
+        free(signal);
+        free(direct);
+        free(ones);
+        stft_resampler_free(resampler);
+        return;
+    }
+    for (int i = 0; i < sample_count; i++) {
+        signal[i] = sinf(2.0f * (float)M_PI * 1000.0f * i / 48000.0f) + sinf(2.0f * (float)M_PI * 10000.0f * i / 48000.0f);
+    }
+    for (int i = 0; i < 8000; i++) {
+        direct[i] = sinf(2.0f * (float)M_PI * 1000.0f * i / 8000.0f);
+    }
+    
+    STFTParameters params = stft_create_parameters(256, 128, 48000.0, WINDOW_HANN, SCALING_SPECTRUM);
+    params.resample_down = 6;
+    STFTParameters direct_params = stft_create_parameters(256, 128, 8000.0, WINDOW_HANN, SCALING_SPECTRUM);
+    STFTResult *result = perform_stft(signal, sample_count, &params);
+    STFTResult *reference = perform_stft(direct, 8000, &direct_params);
+    
+    test_assert(result && result->success, "Decimated STFT succeeds");
+    if (result && result->success && reference && reference->success) {
+        test_assert(result->frame_count == stft_get_frame_count(&params, sample_count) && result->frame_count == reference->frame_count,
+                    "Decimated frame count follows the reduced rate");
+        test_assert(fabs(result->frame_time - 128.0 / 8000.0) < 1e-12 && fabs(result->frequency_resolution - 31.25) < 1e-12,
+                    "Frame time and frequency resolution use the reduced rate");
+    
+        int frame = result->frame_count / 2;
+        float in_band = (float)cpx_magnitude(result->spectrogram_data[frame][32]);
+        float expected = (float)cpx_magnitude(reference->spectrogram_data[frame][32]);
+        float alias = (float)cpx_magnitude(result->spectrogram_data[frame][64]);
+        test_assert(fabsf(in_band - expected) < 0.01f * expected, "Passband tone survives decimation at its bin");
+        test_assert(20.0f * log10f(in_band / (alias + 1e-20f)) > 60.0f, "Tone above the new Nyquist rate is rejected");
+    
+        // The stream resamples as samples arrive; its frames match the whole-signal result
+        STFTStream *stream = stft_stream_create(&params);
+        ResampledStreamCheck check = { result, 0, 0.0 };
+        for (int offset = 0; stream && offset < sample_count; offset += 1000) {
+            stft_stream_push(stream, signal + offset, 1000, compare_resampled_frame, &check);
+        }
+        test_assert(stream && check.frames > result->frame_count - 4 && check.max_error < 1e-6,
+                    "Streaming resampler matches the whole-signal path");
+        stft_stream_free(stream);
+    
+        // 600000 samples upsampled by 4096 pass INT_MAX: the length is exact and every entry point refuses it
+        STFTParameters long_params = params;
+        long_params.resample_down = 1;
+        long_params.resample_up = 4096;
+        float *silence = calloc(600000, sizeof(float));
+        STFTResampler *upsampler = stft_resampler_create(4096, 1, NULL);
+        if (silence && upsampler) {
+            STFTResult *too_long = perform_stft(silence, 600000, &long_params);
+            STFTBatchJob long_job = { silence, 600000, &long_params };
+            BatchResult *long_batch = perform_stft_batch(&long_job, 1, NULL);
+            ResampledStreamCheck none = { result, 0, 0.0 };
+            char *error = stft_process_frames(silence, 600000, &long_params, compare_resampled_frame, &none);
+            test_assert(stft_get_analysis_length(&long_params, 600000) == 2457600000LL &&
+                        stft_get_frame_count(&long_params, 600000) == 0 &&
+                        stft_resampled_length(upsampler, 600000) == 2457600000LL &&
+                        stft_resampler_resample(upsampler, silence, 600000, silence) == -1,
+                        "Resampled lengths past INT_MAX are computed in 64 bits");
+            test_assert(too_long && !too_long->success && too_long->message && strcmp(too_long->message, "Resampled input too long") == 0 &&
+                        long_batch && long_batch->results && !long_batch->results[0]->success &&
+                        strcmp(long_batch->results[0]->message, "Resampled input too long") == 0 &&
+                        error && strcmp(error, "Resampled input too long") == 0 && none.frames == 0,
+                        "Input resampled past INT_MAX is rejected");
+            free(error);
+            batch_free_result(long_batch);
+            stft_free_result(too_long);
+        }
+        stft_resampler_free(upsampler);
+        free(silence);
+    }
+    stft_free_result(result);
+    stft_free_result(reference);
+    
+    // Rational 44.1 -> 48 kHz: unit DC gain on every phase, ceil(n * up / down) samples out
+    for (int i = 0; i < 4000; i++) ones[i] = 1.0f;
+    float *output = malloc(stft_resampled_length(resampler, 4000) * sizeof(float));
+    int length = output ? stft_resampler_resample(resampler, ones, 4000, output) : 0;
+    double max_error = output ? 0.0 : INFINITY;
+    for (int i = 200; i < length - 200; i++) {
+        if (fabs(output[i] - 1.0) > max_error) max_error = fabs(output[i] - 1.0);
+    }
+    test_assert(length == 4354 && max_error < 1e-5, "Rational resampler keeps a constant constant");
+    
+    free(output);
+    stft_resampler_free(resampler);
+    free(signal);
+    free(direct);
+    free(ones);
+}
+
+void test_sample_rate_converter() {
+    // 44.1 -> 16 kHz reduces to 160 / 441; 16000.3 Hz has no small factors and interpolates phases
+    int sample_count = 44100;
+    float *signal = malloc(sample_count * sizeof(float));
+    float *ones = malloc(4000 * sizeof(float));
+    STFTResampler *resampler = stft_resampler_create_ratio(44100.0, 16000.3, NULL);
+    if (!signal || !ones || !resampler) {
+        test_assert(0, "Sample rate converter test setup");
+        free(signal);
+        free(ones);
+        stft_resampler_free(resampler);
+        return;
+    }
+    for (int i = 0; i < sample_count; i++) {
+        signal[i] = sinf(2.0f * (float)M_PI * 1000.0f * i / 44100.0f) + sinf(2.0f * (float)M_PI * 12000.0f * i / 44100.0f);
+    }
+    
+    STFTParameters params = stft_create_parameters(512, 256, 44100.0, WINDOW_HANN, SCALING_SPECTRUM);
+    params.target_sample_rate = 16000.0;
+    STFTResult *result = perform_stft(signal, sample_count, &params);
+    test_assert(result && result->success && result->frame_count == stft_get_frame_count(&params, sample_count) &&
+                stft_get_analysis_length(&params, sample_count) == 16000,
+                "Converted STFT frames the signal at the target rate");
+    if (result && result->success) {
+        test_assert(fabs(result->frame_time - 256.0 / 16000.0) < 1e-12 && fabs(result->frequency_resolution - 31.25) < 1e-12,
+                    "Frame time and frequency resolution use the target rate");
+        int frame = result->frame_count / 2;
+        float tone = (float)cpx_magnitude(result->spectrogram_data[frame][32]);
+        float alias = (float)cpx_magnitude(result->spectrogram_data[frame][128]);
+        test_assert(tone > 10.0f * (float)cpx_magnitude(result->spectrogram_data[frame][40]) && 20.0f * log10f(tone / (alias + 1e-20f)) > 60.0f,
+                    "Converted tone lands on its bin and the out-of-band tone is rejected");
+    
+        // Threaded plans, batches and streams resample per block of frames; all agree with one pass
+        STFTParameters threaded = params;
+        threaded.thread_count = 4;
+        STFTResult *parallel = perform_stft(signal, sample_count, &threaded);
+        STFTBatchJob job = { signal, sample_count, &params };
+        BatchOptions options = { 2, 8 };
+        BatchResult *batch = perform_stft_batch(&job, 1, &options);
+        bool same = parallel && parallel->success && parallel->frame_count == result->frame_count &&
+                    batch && batch->success && batch->results[0]->success && batch->results[0]->frame_count == result->frame_count;
+        for (int f = 0; same && f < result->frame_count; f++) {
+            same = memcmp(parallel->spectrogram_data[f], result->spectrogram_data[f], result->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0 &&
+                   memcmp(batch->results[0]->spectrogram_data[f], result->spectrogram_data[f], result->frequency_bin_count * sizeof(kiss_fft_cpx)) == 0;
+        }
+        test_assert(same, "Plan threads and batch spans resample to the same frames");
+        stft_free_result(parallel);
+        batch_free_result(batch);
+    
+        STFTStream *stream = stft_stream_create(&params);
+        ResampledStreamCheck check = { result, 0, 0.0 };
+        for (int offset = 0; stream && offset + 900 <= sample_count; offset += 900) {
+            stft_stream_push(stream, signal + offset, 900, compare_resampled_frame, &check);
+        }
+        test_assert(stream && check.frames > result->frame_count - 4 && check.max_error < 1e-6,
+                    "Streaming converter matches the whole-signal path");
+        stft_stream_free(stream);
+    }
+    stft_free_result(result);
+    
+    // Interpolated phases keep a constant constant; render matches the sequential conversion
+    for (int i = 0; i < 4000; i++) ones[i] = 1.0f;
+    int length = stft_resampled_length(resampler, 4000);
+    float *output = malloc(length * sizeof(float));
+    float *rendered = malloc(length * sizeof(float));
+    double max_error = output && rendered ? 0.0 : INFINITY;
+    if (output && rendered) {
+        stft_resampler_resample(resampler, signal, 4000, output);
+        stft_resampler_render(resampler, signal, 4000, 100, length - 100, rendered + 100);
+        for (int i = 100; i < length; i++) {
+            if (fabs(output[i] - rendered[i]) > max_error) max_error = fabs(output[i] - rendered[i]);
+        }
+    }
+    test_assert(length == (int)ceil(4000 * 16000.3 / 44100.0) && max_error < 1e-6, "Random-access render matches the stream");
+    
+    max_error = output ? 0.0 : INFINITY;
+    int written = output ? stft_resampler_resample(resampler, ones, 4000, output) : 0;
+    for (int i = 200; i < written - 200; i++) {
+        if (fabs(output[i] - 1.0) > max_error) max_error = fabs(output[i] - 1.0);
+    }
+    test_assert(written == length && max_error < 1e-4, "Interpolated resampler keeps a constant constant");
+    
+    STFTParameters both = params;
+    both.resample_up = 2;
+    char *error = stft_validate_parameters(&both);
+    test_assert(error != NULL, "Target rate excludes resampling factors");
+    free(error);
+    
+    free(output);
+    free(rendered);
+    stft_resampler_free(resampler);
+    free(signal);
+    free(ones);
+}
+
 int main() {
     printf("Running STFT Tests...\n");
     printf("=====================\n");
@@ -303,6 +1732,31 @@ int main() {
     test_stft_edge_cases();
     test_spectrogram_extraction();
     test_time_varying_signal();
+    test_chroma();
+    test_pitch_tracking();
+    test_peak_extraction();
+    test_istft_round_trip();
+    test_hpss();
+    test_streaming_stft();
+    test_denoiser();
+    test_energy_gate();
+    test_encoded_spectrogram();
+    test_fast_accuracy();
+    test_bin_major_layout();
+    test_split_complex_format();
+    test_plan_allocators();
+    test_parallel_execution();
+    test_batch_processing();
+    test_realtime_ring();
+    test_async_jobs();
+    test_pipelined_frame_loop();
+    test_inplace_fft();
+    test_four_step_fft();
+    test_intra_fft_parallelism();
+    test_radix8_fft();
+    test_real_fft_windowing();
+    test_resampling_front_end();
+    test_sample_rate_converter();
     
     printf("\nTest Results:\n");
     printf("=============\n");